@@ -4,6 +4,7 @@
 #include <cmath>
 #include <cstring>
 
+#include "audio_worker.h"
 #include "bus.h"
 
 // Length counter table
@@ -75,20 +76,15 @@ void APU::Pulse::halfFrame(bool isPulse1) {
         }
     }
 }
-void APU::Pulse::clockTimer() {
-    if (timer == 0) {
-        timer = period;
-        seqIndex = (seqIndex + 1) & 7;
-    } else
-        timer--;
+bool APU::Pulse::audible() const {
+    return enabled && lengthCtr != 0 && period >= 8 && period <= 0x7FF && (constantVol ? vol : envVol) != 0;
 }
-float APU::Pulse::sample(bool) const {
-    if (!enabled || lengthCtr == 0 || period < 8 || period > 0x7FF) return 0.0f;
+uint8_t APU::Pulse::level() const {
+    if (!enabled || lengthCtr == 0 || period < 8 || period > 0x7FF) return 0;
     static const uint8_t duty[4][8] = {
         {0, 1, 0, 0, 0, 0, 0, 0}, {0, 1, 1, 0, 0, 0, 0, 0}, {0, 1, 1, 1, 1, 0, 0, 0}, {1, 0, 0, 1, 1, 1, 1, 1}};
     uint8_t bit = duty[dutySel][seqIndex];
-    uint8_t level = constantVol ? vol : envVol;
-    return bit ? (level / 15.0f) : 0.0f;
+    return bit ? (constantVol ? vol : envVol) : 0;
 }
 
 // ===== Triangle =====
@@ -112,18 +108,10 @@ void APU::Triangle::quarterFrame() {
 void APU::Triangle::halfFrame() {
     if (!control && lengthCtr > 0) lengthCtr--;
 }
-void APU::Triangle::clockTimer() {
-    if (lengthCtr == 0 || linCtr == 0) return;
-    if (timer == 0) {
-        timer = period;
-        step = (step + 1) & 31;
-    } else
-        timer--;
-}
-float APU::Triangle::sample() const {
+uint8_t APU::Triangle::level() const {
     static const uint8_t wav[32] = {15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
-    if (lengthCtr == 0 || linCtr == 0 || period < 2) return 0.0f;
-    return (wav[step] / 15.0f - 0.5f) * 0.8f;
+    if (lengthCtr == 0 || linCtr == 0 || period < 2) return 0;
+    return wav[step];
 }
 
 // ===== Noise =====
@@ -162,19 +150,47 @@ void APU::Noise::quarterFrame() {
 void APU::Noise::halfFrame() {
     if (!(envReg & 0x20) && lengthCtr > 0) lengthCtr--;
 }
-void APU::Noise::clockTimer() {
-    if (timer == 0) {
-        timer = period;
-        uint16_t feedback = ((lfsr ^ (lfsr >> ((modeReg & 0x80) ? 6 : 1))) & 1);
-        lfsr = (uint16_t)((lfsr >> 1) | (feedback << 14));
-    } else
-        timer--;
+void APU::Noise::clockShift() {
+    uint16_t feedback = ((lfsr ^ (lfsr >> ((modeReg & 0x80) ? 6 : 1))) & 1);
+    lfsr = (uint16_t)((lfsr >> 1) | (feedback << 14));
+}
+
+// The LFSR step is linear over GF(2), so 2^i steps are one 15x15 bit matrix
+// (stored as the images of the 15 basis states) per mode. Long mode cycles
+// through all 32767 nonzero states; short mode's cycles are 93 or 31 long.
+struct LfsrJumps {
+    uint16_t cols[2][15][15];  // [short mode][i: 2^i steps][basis bit]
+};
+constexpr uint16_t lfsrApply(const uint16_t (&cols)[15], uint16_t s) {
+    uint16_t r = 0;
+    for (int j = 0; j < 15; ++j)
+        if ((s >> j) & 1) r ^= cols[j];
+    return r;
+}
+constexpr LfsrJumps makeLfsrJumps() {
+    LfsrJumps t{};
+    for (int m = 0; m < 2; ++m) {
+        const int tap = m ? 6 : 1;
+        for (int j = 0; j < 15; ++j) {
+            const uint16_t s = (uint16_t)(1u << j);
+            t.cols[m][0][j] = (uint16_t)((s >> 1) | (((s ^ (s >> tap)) & 1) << 14));
+        }
+        for (int i = 1; i < 15; ++i)
+            for (int j = 0; j < 15; ++j) t.cols[m][i][j] = lfsrApply(t.cols[m][i - 1], t.cols[m][i - 1][j]);
+    }
+    return t;
+}
+constexpr LfsrJumps kLfsrJumps = makeLfsrJumps();
+
+void APU::Noise::advance(uint64_t steps) {
+    const int m = (modeReg & 0x80) ? 1 : 0;
+    steps %= m ? 93u : 32767u;
+    for (int i = 0; steps; ++i, steps >>= 1)
+        if (steps & 1) lfsr = lfsrApply(kLfsrJumps.cols[m][i], lfsr);
 }
-float APU::Noise::sample() const {
-    if (lengthCtr == 0) return 0.0f;
-    uint8_t level = constantVol ? vol : envVol;
-    float v = (lfsr & 1) ? 1.0f : -1.0f;
-    return v * (level / 15.0f) * 0.25f;
+uint8_t APU::Noise::level() const {
+    if (lengthCtr == 0 || (lfsr & 1)) return 0;  // shift register bit 0 mutes
+    return constantVol ? vol : envVol;
 }
 
 // ===== DMC =====
@@ -197,13 +213,7 @@ void APU::DMC::restartSample() {
     curAddr = addr;
     bytesLeft = length;
 }
-void APU::DMC::clockTimer(APU* apu) {
-    if (timer > 0) {
-        timer--;
-        return;
-    }
-    timer = rate;
-
+void APU::DMC::clockOutput(APU* apu) {
     if (!silence) {
         if ((shift & 1) && output <= 125)
             output += 2;
@@ -224,7 +234,7 @@ void APU::DMC::clockTimer(APU* apu) {
             }
         }
         if (bytesLeft > 0) {
-            uint8_t b = apu->bus->cpuRead(curAddr);
+            uint8_t b = apu->dmcRead(curAddr);
             curAddr = (uint16_t)(curAddr + 1);
             bytesLeft--;
             shift = b;
@@ -234,64 +244,419 @@ void APU::DMC::clockTimer(APU* apu) {
 }
 
 // ===== Mixer =====
-float APU::mix() const {
-    float p1 = pulse1.sample(true);
-    float p2 = pulse2.sample(false);
-    float t = tri.sample();
-    float n = noise.sample();
-    float d = dmc.sample() * 0.8f;
+// Nesdev lookup tables for the non-linear DAC, pre-scaled to AMP_SCALE:
+//   pulse[n] = 95.52 / (8128 / n + 100),       n = p1 + p2            (0..30)
+//   tnd[n]   = 163.67 / (24329 / n + 100),     n = 3*t + 2*noise + dmc (0..202)
+namespace {
+template <int N>
+struct MixTable {
+    int v[N];
+};
+
+constexpr int roundToInt(double x) { return (int)(x + 0.5); }
+
+constexpr MixTable<31> makePulseTable() {
+    MixTable<31> t{};
+    for (int n = 1; n < 31; ++n) t.v[n] = roundToInt(95.52 / (8128.0 / n + 100.0) * APU::AMP_SCALE);
+    return t;
+}
+constexpr MixTable<203> makeTndTable() {
+    MixTable<203> t{};
+    for (int n = 1; n < 203; ++n) t.v[n] = roundToInt(163.67 / (24329.0 / n + 100.0) * APU::AMP_SCALE);
+    return t;
+}
+constexpr MixTable<31> kPulseMix = makePulseTable();
+constexpr MixTable<203> kTndMix = makeTndTable();
 
-    // Non-linear mixing approximations (Nesdev)
-    float pulseOut = (p1 == 0.0f && p2 == 0.0f) ? 0.0f
-                                                : (95.88f / ((8128.0f / (p1 * 15.0f + p2 * 15.0f)) + 100.0f));
+// The tables must agree with Nesdev's reference mixer formulas to within 1/64
+// of full scale.
+constexpr double kMixTolerance = APU::AMP_SCALE / 64.0;
+constexpr double absd(double x) { return x < 0 ? -x : x; }
+constexpr double pulseFormula(int p1, int p2) {
+    return (p1 + p2 == 0) ? 0.0 : 95.88 / (8128.0 / (p1 + p2) + 100.0) * APU::AMP_SCALE;
+}
+constexpr double tndFormula(int t, int n, int d) {
+    double s = t / 8227.0 + n / 12241.0 + d / 22638.0;
+    return (s == 0.0) ? 0.0 : 159.79 / (1.0 / s + 100.0) * APU::AMP_SCALE;
+}
+constexpr bool tndWithinTolerance(int t, int n, int d) {
+    return absd(kTndMix.v[3 * t + 2 * n + d] - tndFormula(t, n, d)) <= kMixTolerance;
+}
+constexpr bool mixTablesMatchFormulas() {
+    for (int p1 = 0; p1 < 16; ++p1)
+        for (int p2 = 0; p2 < 16; ++p2)
+            if (absd(kPulseMix.v[p1 + p2] - pulseFormula(p1, p2)) > kMixTolerance) return false;
+    // Full triangle x noise grid at three DMC levels, full DMC range at the extremes
+    const int dmcLevels[3] = {0, 64, 127};
+    for (int t = 0; t < 16; ++t)
+        for (int n = 0; n < 16; ++n)
+            for (int d : dmcLevels)
+                if (!tndWithinTolerance(t, n, d)) return false;
+    for (int d = 0; d < 128; ++d)
+        if (!tndWithinTolerance(0, 0, d) || !tndWithinTolerance(15, 15, d)) return false;
+    return true;
+}
+static_assert(kPulseMix.v[30] + kTndMix.v[202] <= APU::AMP_SCALE, "mixer full scale overflows AMP_SCALE");
+static_assert(mixTablesMatchFormulas(), "mixer tables diverge from the Nesdev mixer formulas");
+}  // namespace
 
-    float tndIn = (t / 0.8f) * 8227.0f + (n / 0.25f) * 12241.0f + d * 22638.0f;
-    float tndOut = (tndIn == 0.0f) ? 0.0f : (159.79f / (100.0f + tndIn));
+int APU::mix() const {
+    return kPulseMix.v[pulse1.level() + pulse2.level()] + kTndMix.v[3 * tri.level() + 2 * noise.level() + dmc.level()];
+}
+
+int APU::mixStems(int out[StemCount]) const {
+    const int p1 = pulse1.level(), p2 = pulse2.level(), t = tri.level(), n = noise.level(), d = dmc.level();
+    out[StemPulse1] = kPulseMix.v[p1];
+    out[StemPulse2] = kPulseMix.v[p2];
+    out[StemTriangle] = kTndMix.v[3 * t];
+    out[StemNoise] = kTndMix.v[2 * n];
+    out[StemDmc] = kTndMix.v[d];
+    return kPulseMix.v[p1 + p2] + kTndMix.v[3 * t + 2 * n + d];
+}
 
-    return pulseOut + tndOut;  // ~0..1
+const char* APU::stemName(Stem s) {
+    static const char* const names[StemCount] = {"pulse1", "pulse2", "tri", "noise", "dmc"};
+    return names[s];
+}
+
+// ===== Lazy clocking =====
+// Advances a reload-at-zero countdown by `elapsed` CPU cycles; returns the number of reloads
+static uint64_t advanceTimer(uint16_t& timer, uint32_t period, uint64_t elapsed) {
+    if (elapsed <= timer) {
+        timer = (uint16_t)(timer - elapsed);
+        return 0;
+    }
+    uint64_t e = elapsed - timer - 1;  // cycles after the first reload
+    timer = (uint16_t)(period - e % (period + 1));
+    return 1 + e / (period + 1);
+}
+
+void APU::sync(uint64_t t) {
+    if (t <= apuTime) return;
+    const uint64_t a = apuTime;
+    const uint64_t never = Scheduler::kNever;
+
+    // Audible channels are stepped period by period, merged in time order, since
+    // each step can move the mix. Everything else only needs its counters moved,
+    // which is done in closed form below. Audibility cannot change inside a sync:
+    // it only depends on registers and frame-sequencer state.
+    // The tracking half of a split APU has no output: only the DMC matters there.
+    const bool synth = (mode != Mode::Track);
+    const bool p1 = synth && pulse1.audible(), p2 = synth && pulse2.audible(), tr = synth && tri.audible();
+    const bool nz = synth && noise.audible(), dm = !dmc.idle();
+    uint64_t n1 = p1 ? a + pulse1.timer + 1 : never;
+    uint64_t n2 = p2 ? a + pulse2.timer + 1 : never;
+    uint64_t nt = tr ? a + tri.timer + 1 : never;
+    uint64_t nn = nz ? a + noise.timer + 1 : never;
+    uint64_t nd = dm ? a + dmc.timer + 1 : never;
+
+    for (;;) {
+        uint64_t n = std::min(std::min(std::min(n1, n2), std::min(nt, nn)), nd);
+        if (n > t) break;
+        if (n1 == n) {
+            pulse1.seqIndex = (pulse1.seqIndex + 1) & 7;
+            n1 = n + pulse1.period + 1;
+        }
+        if (n2 == n) {
+            pulse2.seqIndex = (pulse2.seqIndex + 1) & 7;
+            n2 = n + pulse2.period + 1;
+        }
+        if (nt == n) {
+            tri.step = (tri.step + 1) & 31;
+            nt = n + tri.period + 1;
+        }
+        if (nn == n) {
+            noise.clockShift();
+            nn = n + noise.period + 1;
+        }
+        if (nd == n) {
+            dmcClock = n;
+            dmc.clockOutput(this);
+            nd = n + dmc.rate + 1;
+        }
+        updateAmp(n - 1);
+    }
+
+    const uint64_t elapsed = t - a;
+    if (p1)
+        pulse1.timer = (uint16_t)(n1 - t - 1);
+    else if (synth)
+        pulse1.seqIndex = (uint8_t)((pulse1.seqIndex + advanceTimer(pulse1.timer, pulse1.period, elapsed)) & 7);
+    if (p2)
+        pulse2.timer = (uint16_t)(n2 - t - 1);
+    else if (synth)
+        pulse2.seqIndex = (uint8_t)((pulse2.seqIndex + advanceTimer(pulse2.timer, pulse2.period, elapsed)) & 7);
+    if (tr)
+        tri.timer = (uint16_t)(nt - t - 1);
+    else if (synth && tri.clocked())
+        tri.step = (uint8_t)((tri.step + advanceTimer(tri.timer, tri.period, elapsed)) & 31);
+    if (nz) {
+        noise.timer = (uint16_t)(nn - t - 1);
+    } else if (synth) {
+        // Muted, but the LFSR phase is audible once it comes back
+        noise.advance(advanceTimer(noise.timer, noise.period, elapsed));
+    }
+    if (dm) {
+        dmc.timer = (uint16_t)(nd - t - 1);
+    } else {
+        // Idle: the output unit keeps shifting out an empty buffer
+        uint64_t k = advanceTimer(dmc.timer, dmc.rate, elapsed);
+        dmc.shift = (k >= 8) ? 0 : (uint8_t)(dmc.shift >> k);
+        dmc.bits = (uint8_t)((dmc.bits - 1 + 8 - k % 8) % 8 + 1);
+    }
+    apuTime = t;
+}
+
+uint8_t APU::dmcRead(uint16_t addr) {
+    switch (mode) {
+        case Mode::Replay: {
+            if (dmcFeed.empty()) return 0;  // log and replay disagree; stay quiet
+            uint8_t b = dmcFeed.front();
+            dmcFeed.pop_front();
+            return b;
+        }
+        case Mode::Track: {
+            uint8_t b = bus->cpuRead(addr);
+            log.push_back({dmcClock, ApuLogEntry::kDmcFetch, b});
+            return b;
+        }
+        default:
+            return bus->cpuRead(addr);
+    }
+}
+
+void APU::scheduleDmc() {
+    if (!sched) return;
+    if (dmc.idle()) {
+        sched->cancel(Scheduler::ApuDmc);
+        return;
+    }
+    // The byte boundary is where fetches (and end-of-sample IRQs) happen
+    uint64_t boundary = apuTime + dmc.timer + 1 + (uint64_t)(dmc.bits - 1) * (dmc.rate + 1);
+    sched->schedule(Scheduler::ApuDmc, boundary);
+}
+
+void APU::dmcEvent(uint64_t at) {
+    sync(at);
+    scheduleDmc();
 }
 
 // ===== Sequencer / API =====
+// Cycles from sequence start: 4-step Q,QH,Q,QH+IRQ; 5-step Q,QH,Q,QH,(wrap)
+static const uint32_t kFrameSteps[2][5] = {{3730, 7458, 11187, 14915, 0}, {3730, 7458, 11187, 14916, 18641}};
+
 void APU::resetFrameSequencer(bool fiveStep, bool inhibitIRQ, bool immediateClock) {
     mode5 = fiveStep;
     irqInhibit = inhibitIRQ;
     frameIRQ = false;
-    fcCycle = 0.0;
+    fcStart = apuTime;
     fcStep = 0;
+    if (sched) sched->schedule(Scheduler::ApuFrameSequencer, fcStart + kFrameSteps[mode5][0]);
 
     if (mode5 && immediateClock) {
         // Writing $4017 with bit7=1 clocks both Q & H immediately
         quarterFrame();
         halfFrame();
     }
+    updateAmp(apuTime);  // also settles blip on the power-on DAC level
+}
+
+void APU::frameSequencerEvent(uint64_t at) {
+    sync(at);
+    const int last = mode5 ? 4 : 3;
+    if (fcStep < 4) quarterFrame();
+    if (fcStep == 1 || fcStep == 3) halfFrame();
+    if (!mode5 && fcStep == 3 && !irqInhibit) frameIRQ = true;
+    updateAmp(at - 1);
+
+    if (fcStep == last) {
+        fcStart = at;
+        fcStep = 0;
+    } else {
+        fcStep++;
+    }
+    sched->schedule(Scheduler::ApuFrameSequencer, fcStart + kFrameSteps[mode5][fcStep]);
+
+    // Nobody is closing frames (e.g. a stalled caller): don't overrun blip
+    if (at - frameStart >= MAX_FRAME_CLOCKS / 2) closeFrame(at);
 }
 
 void APU::init() {
+    if (mode == Mode::Track) return;  // the AudioWorker's APU owns synthesis and the device
+
+    // Ring must exist before the callback can fire
+    ring.init(BUFFER_SAMPLES);
+
     SDL_AudioSpec want{}, have{};
     want.freq = 48000;  // 48k mixes well on Linux
     want.format = AUDIO_S16SYS;
     want.channels = 1;
-    want.samples = 2048;      // bigger buffer = fewer xruns
-    want.callback = nullptr;  // <<< queued audio, no callback
+    want.samples = 512;  // short callback period; depth is managed by the ring
+    want.callback = &APU::audioCallback;
+    want.userdata = this;
+
+    // Synthesis runs at a fixed rate whatever the device does
+    blip.init(double(SYNTH_RATE) / CPU_CLOCK, MAX_FRAME_CLOCKS);
+    blip.setRatio(double(SYNTH_RATE) / CPU_CLOCK / speedFactor);
+    synthBuf.assign(SYNTH_CHUNK, 0);
+
+    if (capture) {
+        // Offline: no device, no ring, no rate control
+        stems.clear();
+        if (capture->stems) {
+            stems.resize(StemCount);
+            for (StemTrack& st : stems) {
+                st.blip.init(double(SYNTH_RATE) / CPU_CLOCK, MAX_FRAME_CLOCKS);
+                st.blip.setRatio(double(SYNTH_RATE) / CPU_CLOCK);
+            }
+        }
+        sampleRate = capture->sampleRate;
+        setQuality(quality);
+        return;
+    }
 
     dev = SDL_OpenAudioDevice(nullptr, 0, &want, &have, 0);
-    if (!dev) return;
+    if (!dev) return;  // keep synthesizing (the samples are dropped) so timing is unaffected
+
+    // Match the resampler to the actual device rate
+    sampleRate = have.freq;
+    setQuality(quality);
 
-    // Match resampler to the actual device rate
-    sampleRate = have.freq;  // add member: int sampleRate (or reuse existing)
-    samplesPerCpu = double(sampleRate) / 1789773.0;
+    // Keep one device period plus ~2 video frames queued: the emulation thread
+    // produces a whole frame of audio at a time.
+    deviceSamples = have.samples;
+    targetFill = std::min(deviceSamples + sampleRate / 30, BUFFER_SAMPLES * 3 / 4);
+    fillAvg = targetFill;
 
     SDL_PauseAudioDevice(dev, 0);
 }
 
 void APU::shutdown() {
     if (dev) {
-        SDL_ClearQueuedAudio(dev);
-        SDL_CloseAudioDevice(dev);
+        SDL_CloseAudioDevice(dev);  // stops the callback
     }
     dev = 0;
 }
 
+void APU::setQuality(Resampler::Quality q) {
+    quality = q;
+    if (worker) {
+        worker->setQuality(q);
+        return;
+    }
+    baseStep = double(SYNTH_RATE) / sampleRate;
+    resampler.init(SYNTH_RATE, sampleRate, quality, baseStep * (1.0 + MAX_RATE_ADJUST));
+    resampler.setStep(baseStep / (1.0 + rateAdjust));
+    outBuf.assign((size_t)(SYNTH_CHUNK / (baseStep / (1.0 + MAX_RATE_ADJUST))) + 4, 0);
+    for (StemTrack& st : stems) st.resampler.init(SYNTH_RATE, sampleRate, quality, baseStep);
+}
+
+void APU::setSpeed(int factor) {
+    endFrame();  // timestamps so far belong to the old ratio
+    speedFactor = std::max(1, factor);
+    if (worker) {
+        worker->setSpeed(speedFactor);
+        return;
+    }
+    blip.setRatio(double(SYNTH_RATE) / CPU_CLOCK / speedFactor);
+    for (StemTrack& st : stems) st.blip.setRatio(double(SYNTH_RATE) / CPU_CLOCK / speedFactor);
+    rateAdjust = 0.0;
+    resampler.setStep(baseStep);
+    // Drop the realtime backlog when entering/leaving turbo (callback locked out meanwhile)
+    if (dev) {
+        SDL_LockAudioDevice(dev);
+        ring.clear();
+        SDL_UnlockAudioDevice(dev);
+    }
+}
+
+void APU::audioCallback(void* user, Uint8* stream, int len) {
+    APU* apu = static_cast<APU*>(user);
+    int16_t* out = reinterpret_cast<int16_t*>(stream);
+    size_t want = (size_t)len / sizeof(int16_t);
+    size_t got = apu->ring.pop(out, want);
+
+    if (got > 0) apu->lastSample = out[got - 1];
+    if (got < want) {
+        // Count each dry spell once, not every callback while paused
+        if (!apu->starved) apu->underruns.fetch_add(1, std::memory_order_relaxed);
+        apu->starved = true;
+        std::fill(out + got, out + want, apu->lastSample);
+    } else {
+        apu->starved = false;
+    }
+}
+
+void APU::flushOutput(int count) {
+    if (!dev) return;
+    size_t pushed = ring.push(outBuf.data(), (size_t)count);
+    // Turbo outruns the device by design; only count overruns at realtime speed
+    if (pushed < (size_t)count && speedFactor == 1) overruns.fetch_add(1, std::memory_order_relaxed);
+    if (speedFactor != 1) return;
+
+    // Dynamic rate control: nudge the output ratio to hold the ring at targetFill
+    fillAvg += ((double)ring.size() - fillAvg) * 0.05;
+    double err = (fillAvg - targetFill) / (double)targetFill;
+    rateAdjust = std::clamp(-err * MAX_RATE_ADJUST, -MAX_RATE_ADJUST, MAX_RATE_ADJUST);
+    resampler.setStep(baseStep / (1.0 + rateAdjust));  // more output per input when the ring runs low
+}
+
+double APU::latencyMs() const {
+    if (!dev || sampleRate <= 0) return 0.0;
+    return 1000.0 * (double)(ring.size() + (size_t)deviceSamples) / (double)sampleRate;
+}
+
+void APU::updateAmp(uint64_t at) {
+    if (mode == Mode::Track) return;
+    int amp;
+    if (stems.empty()) {
+        amp = mix();
+    } else {
+        int amps[StemCount];
+        amp = mixStems(amps);
+        for (int i = 0; i < StemCount; ++i) {
+            if (amps[i] == stems[i].amp) continue;
+            stems[i].blip.addDelta((uint32_t)(at - frameStart), amps[i] - stems[i].amp);
+            stems[i].amp = amps[i];
+        }
+    }
+    if (amp == blipAmp) return;
+    blip.addDelta((uint32_t)(at - frameStart), amp - blipAmp);
+    blipAmp = amp;
+}
+
+void APU::endFrame() { closeFrame(sched ? sched->now : apuTime); }
+
+void APU::closeFrame(uint64_t at) {
+    sync(at);
+    if (mode == Mode::Track) {
+        if (worker) worker->submitFrame(log, at);  // hands the log over, leaves an empty one
+        log.clear();
+        frameStart = at;
+        return;
+    }
+    const uint32_t clocks = (uint32_t)(at - frameStart);
+    blip.endFrame(clocks);
+    frameStart = at;
+    int n;
+    while ((n = blip.readSamples(synthBuf.data(), SYNTH_CHUNK)) > 0) {
+        if (capture) {
+            capture->write(0, outBuf.data(), resampler.process(synthBuf.data(), n, outBuf.data(), (int)outBuf.size()));
+            continue;
+        }
+        if (!dev) continue;  // drain only
+        flushOutput(resampler.process(synthBuf.data(), n, outBuf.data(), (int)outBuf.size()));
+    }
+    for (size_t i = 0; i < stems.size(); ++i) {
+        StemTrack& st = stems[i];
+        st.blip.endFrame(clocks);
+        while ((n = st.blip.readSamples(synthBuf.data(), SYNTH_CHUNK)) > 0) {
+            capture->write((int)i + 1, outBuf.data(),
+                           st.resampler.process(synthBuf.data(), n, outBuf.data(), (int)outBuf.size()));
+        }
+    }
+}
+
 void APU::quarterFrame() {
     pulse1.quarterFrame();
     pulse2.quarterFrame();
@@ -304,86 +669,9 @@ void APU::halfFrame(){
     tri.halfFrame();
     noise.halfFrame();
 }
-void APU::tickCPU() {
-    // channel timers
-    pulse1.clockTimer();
-    pulse2.clockTimer();
-    tri.clockTimer();
-    noise.clockTimer();
-    dmc.clockTimer(this);
-
-    // audio resampling
-    int emit = resampFrac.step(samplesPerCpu);
-    static int16_t chunk[2048];
-    static int chunkPos = 0;
-
-    while (emit--) {
-        float s = std::clamp(mix(), 0.0f, 1.0f);
-        int16_t q = (int16_t)((s * 2.0f - 1.0f) * 12000);
-
-        chunk[chunkPos++] = q;
-        // Flush in reasonable batches, and keep device topped up
-        if (chunkPos >= 512) {
-            if (dev) {
-                SDL_QueueAudio(dev, chunk, chunkPos * sizeof(int16_t));
-            }
-            chunkPos = 0;
-        }
-    }
-
-    // exact frame sequencer cadence
-    fcCycle += 1.0;
-    if (!mode5) {
-        // 4-step: Q at 3729.5, 7457.5, 11186.5, 14915; H at 7457.5, 14915
-        if (fcCycle >= 3729.5 && fcStep == 0) {
-            quarterFrame();
-            fcStep = 1;
-        }
-        if (fcCycle >= 7457.5 && fcStep <= 1) {
-            quarterFrame();
-            halfFrame();
-            fcStep = 2;
-        }
-        if (fcCycle >= 11186.5 && fcStep <= 2) {
-            quarterFrame();
-            fcStep = 3;
-        }
-        if (fcCycle >= 14915.0 && fcStep <= 3) {
-            quarterFrame();
-            halfFrame();
-            if (!irqInhibit) frameIRQ = true;
-            fcCycle -= 14915.0;
-            fcStep = 0;
-        }
-    } else {
-        // 5-step: Q at 3729.5, 7457.5, 11186.5, 14915.5, 18641; H at 7457.5, 14915.5; no IRQ
-        if (fcCycle >= 3729.5 && fcStep == 0) {
-            quarterFrame();
-            fcStep = 1;
-        }
-        if (fcCycle >= 7457.5 && fcStep <= 1) {
-            quarterFrame();
-            halfFrame();
-            fcStep = 2;
-        }
-        if (fcCycle >= 11186.5 && fcStep <= 2) {
-            quarterFrame();
-            fcStep = 3;
-        }
-        if (fcCycle >= 14915.5 && fcStep <= 3) {
-            quarterFrame();
-            halfFrame();
-            fcStep = 4;
-        }
-        if (fcCycle >= 18641.0 && fcStep <= 4) {
-            fcCycle -= 18641.0;
-            fcStep = 0;
-        }
-    }
-}
-
 uint8_t APU::cpuRead(uint16_t a) {
     if (a == 0x4015) {
+        sync(sched ? sched->now : apuTime);  // length counters / DMC bytes as of this cycle
         uint8_t s = 0;
         if (pulse1.lengthCtr > 0) s |= 0x01;
         if (pulse2.lengthCtr > 0) s |= 0x02;
@@ -401,6 +689,9 @@ uint8_t APU::cpuRead(uint16_t a) {
 }
 
 void APU::cpuWrite(uint16_t a, uint8_t v) {
+    // Everything before this cycle ran under the old register values
+    sync(sched ? sched->now : apuTime);
+    if (mode == Mode::Track) log.push_back({apuTime, a, v});
     switch (a) {
         // Pulse 1
         case 0x4000:
@@ -491,4 +782,6 @@ void APU::cpuWrite(uint16_t a, uint8_t v) {
         default:
             break;
     }
+    updateAmp(apuTime);
+    scheduleDmc();
 }
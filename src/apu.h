@@ -3,29 +3,81 @@
 #include <SDL2/SDL.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
 
-#include "apu_clock.h"
+#include "blip_buffer.h"
+#include "resampler.h"
+#include "ring_buffer.h"
+#include "scheduler.h"
 
 struct Bus;  // for DMC memory fetch
+struct AudioWorker;
+
+// One APU event as seen by the emulation thread: a $4000-$4017 write, or the
+// byte a DMC fetch returned (addr == kDmcFetch), stamped with its CPU cycle
+struct ApuLogEntry {
+    static constexpr uint16_t kDmcFetch = 0xFFFF;
+    uint64_t cycle;
+    uint16_t addr;
+    uint8_t value;
+};
+
+// Offline output (audio-only rendering): resampled PCM is handed to `write`
+// instead of an audio device. Track 0 is the mix; with `stems`, tracks 1..5
+// are the channels on their own (APU::Stem order), each through the same DAC
+// tables, so they add up to the mix only where the DAC is near linear.
+struct AudioCapture {
+    int sampleRate = 48000;
+    bool stems = false;
+    std::function<void(int track, const int16_t* samples, int count)> write;
+};
 
 struct APU {
     // SDL audio device
     SDL_AudioDeviceID dev = 0;
     static constexpr int SAMPLE_RATE = 48000;
-    static constexpr int BUFFER_SAMPLES = 4096;
+    static constexpr int SYNTH_RATE = 96000;        // blip output; resampled to the device rate
+    static constexpr int SYNTH_CHUNK = 2048;        // synthesis samples resampled per batch (> 1 frame)
+    static constexpr int BUFFER_SAMPLES = 4096;     // ring capacity (~85 ms @ 48k)
+    static constexpr double MAX_RATE_ADJUST = 0.005;  // dynamic rate control: +-0.5%
+    static constexpr double CPU_CLOCK = 1789773.0;     // NTSC
+    static constexpr uint32_t MAX_FRAME_CLOCKS = 1u << 16;  // blip capacity; endFrame() is forced at half
+    static constexpr int AMP_SCALE = 24000;            // mixer full scale (1.0) in synthesis units
 
     // CPU coupling (for DMC memory reads)
     Bus* bus = nullptr;
 
-    // ----- Frame sequencer (exact cadence) -----
+    // Master clock. Channels are not clocked per cycle: sync() catches them up
+    // to a CPU cycle when a register is touched, a scheduled event fires or a
+    // frame of audio is closed.
+    Scheduler* sched = nullptr;
+    uint64_t apuTime = 0;  // CPU cycles the channels have been advanced through
+    void sync(uint64_t t);
+
+    // Split operation. Full: clock, mix and output right here. Track: the
+    // emulation-side half; keeps only CPU-visible state (length counters,
+    // IRQs, DMC fetches) and logs every write and fetch for the AudioWorker.
+    // Replay: the worker's half, synthesizing from that log.
+    enum class Mode { Full, Track, Replay };
+    Mode mode = Mode::Full;
+    AudioWorker* worker = nullptr;  // Track
+    std::vector<ApuLogEntry> log;   // Track: the current frame
+    std::deque<uint8_t> dmcFeed;    // Replay: logged DMC bytes, in fetch order
+    uint64_t dmcClock = 0;          // cycle of the DMC step being run
+    uint8_t dmcRead(uint16_t addr);
+
+    // ----- Frame sequencer (exact cadence, integer deadlines) -----
     bool mode5 = false;       // 5-step if true
     bool irqInhibit = false;  // inhibit frame IRQs if true
     bool frameIRQ = false;    // raised at end of 4-step sequence (if not inhibited)
-    double fcCycle = 0.0;     // cycles since sequence start
-    int fcStep = 0;           // current step index
+    uint64_t fcStart = 0;     // cycle the current sequence started
+    int fcStep = 0;           // next step index
     void resetFrameSequencer(bool fiveStep, bool inhibitIRQ, bool immediateClock);
-    void frameSequencerStep();  // maintained internally via tickCPU exact timing
+    void frameSequencerEvent(uint64_t at);  // Scheduler::ApuFrameSequencer
 
     // ----- Length table -----
     static const uint8_t lengthTable[32];
@@ -64,10 +116,10 @@ struct APU {
 
         void quarterFrame();  // envelope
         void halfFrame(bool isPulse1);
-        void clockTimer();
 
         int targetPeriod(bool isPulse1) const;
-        float sample(bool isPulse1) const;
+        bool audible() const;  // false: level() is 0 whatever the sequencer does
+        uint8_t level() const;  // 0-15
     } pulse1, pulse2;
 
     // ----- Triangle -----
@@ -90,8 +142,9 @@ struct APU {
 
         void quarterFrame();  // linear counter
         void halfFrame();     // length counter
-        void clockTimer();
-        float sample() const;
+        bool clocked() const { return lengthCtr != 0 && linCtr != 0; }  // timer halts otherwise
+        bool audible() const { return clocked() && period >= 2; }
+        uint8_t level() const;  // 0-15
     } tri;
 
     // ----- Noise -----
@@ -118,8 +171,10 @@ struct APU {
 
         void quarterFrame();
         void halfFrame();
-        void clockTimer();
-        float sample() const;
+        void clockShift();
+        void advance(uint64_t steps);  // `steps` clockShift()s in closed form
+        bool audible() const { return lengthCtr != 0 && (constantVol ? vol : envVol) != 0; }
+        uint8_t level() const;  // 0-15
     } noise;
 
     // ----- DMC -----
@@ -142,29 +197,73 @@ struct APU {
         void write2(uint8_t v);
         void write3(uint8_t v);
         void restartSample();
-        void clockTimer(APU* apu);  // pulls bytes from CPU Bus
+        void clockOutput(APU* apu);  // one timer period: shift a bit out, pull bytes from CPU Bus
+        // No sample playing, nothing to restart or raise: only the counters move
+        bool idle() const { return silence && bytesLeft == 0 && !(reg0 & 0xC0); }
 
-        float sample() const { return (output / 127.0f) - 0.5f; }
+        uint8_t level() const { return output; }  // 0-127
     } dmc;
 
     // DMC / Frame-IRQ flags exposed to CPU
     bool dmcIRQ = false;
     inline bool irqLine() const { return frameIRQ || dmcIRQ; }
+    void scheduleDmc();                // arm Scheduler::ApuDmc for the next byte boundary
+    void dmcEvent(uint64_t at);        // Scheduler::ApuDmc
+
+    // Mixer: non-linear DAC via lookup tables, in AMP_SCALE units
+    int mix() const;
+
+    // Band-limited synthesis: the mixed amplitude is re-evaluated only when
+    // something that feeds it changed, and each change becomes a step in blip
+    BlipBuffer blip;
+    uint64_t frameStart = 0;  // cycle of the last endFrame()
+    int blipAmp = 0;          // amplitude last handed to blip
+    void updateAmp(uint64_t at);
+    void closeFrame(uint64_t at);
 
-    // Mixer
-    float mix() const;
+    // Capture instead of a device (set before init). Stems get a blip and a
+    // resampler each and follow the mix step for step.
+    enum Stem { StemPulse1, StemPulse2, StemTriangle, StemNoise, StemDmc, StemCount };
+    static const char* stemName(Stem s);  // "pulse1", "pulse2", "tri", "noise", "dmc"
+    struct StemTrack {
+        BlipBuffer blip;
+        Resampler resampler;
+        int amp = 0;
+    };
+    const AudioCapture* capture = nullptr;
+    std::vector<StemTrack> stems;  // empty unless capture->stems
+    int mixStems(int out[StemCount]) const;  // mix(), plus each channel on its own
 
-    // Audio resampling/output
-    ClockFrac resampFrac;
+    // Audio output: blip (SYNTH_RATE) -> polyphase resampler (device rate) -> ring
+    Resampler resampler;
+    Resampler::Quality quality = Resampler::Quality::Medium;
     int sampleRate = SAMPLE_RATE;
-    double samplesPerCpu = (double)SAMPLE_RATE / 1789773.0;  // NTSC CPU
-    int16_t outBuf[BUFFER_SAMPLES]{};
-    int outPos = 0;
+    double baseStep = (double)SYNTH_RATE / SAMPLE_RATE;  // resampler input/output, before rate control
+    int speedFactor = 1;  // turbo: synthesize at 1/N the rate so pitch/queue stay sane
+    std::vector<int16_t> synthBuf, outBuf;
+
+    // Pull model: endFrame (emulation thread) -> ring -> SDL callback (audio thread)
+    SpscRing<int16_t> ring;
+    int deviceSamples = 0;    // SDL callback period
+    int targetFill = 0;       // ring depth the rate controller steers towards
+    double fillAvg = 0.0;     // smoothed ring depth
+    std::atomic<double> rateAdjust{0.0};  // current ratio nudge, within +-MAX_RATE_ADJUST
+    int16_t lastSample = 0;   // audio thread: held on underrun to avoid clicks
+    bool starved = false;     // audio thread: inside an underrun
+    std::atomic<uint64_t> underruns{0};
+    std::atomic<uint64_t> overruns{0};
+
+    double latencyMs() const;  // ring depth + device buffer
+    static void audioCallback(void* user, Uint8* stream, int len);
+    void flushOutput(int count);  // outBuf -> ring, then rate control
+    void setQuality(Resampler::Quality q);
 
     // API
+    ~APU() { shutdown(); }
     void init();
     void shutdown();
-    void tickCPU();       // call once per CPU cycle
+    void setSpeed(int factor);  // audio decimation for turbo (1 = realtime)
+    void endFrame();      // call once per video frame: synthesize and queue the frame's audio
     void quarterFrame();  // triggered by sequencer
     void halfFrame();     // triggered by sequencer
 
@@ -0,0 +1,108 @@
+// audio_render.cpp
+#include "audio_render.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "apu.h"
+#include "input.h"
+#include "nes.h"
+#include "wav_writer.h"
+
+namespace {
+
+int usage() {
+    std::fprintf(stderr,
+                 "usage: nes --render-wav <rom> <out.wav> [--seconds N] [--rate HZ]"
+                 " [--quality low|medium|high] [--stems]\n");
+    return 1;
+}
+
+// out.wav -> out.<stem>.wav
+std::string stemPath(const std::string& out, const char* stem) {
+    size_t dot = out.find_last_of('.');
+    size_t slash = out.find_last_of("/\\");
+    std::string base = (dot != std::string::npos && (slash == std::string::npos || dot > slash)) ? out.substr(0, dot) : out;
+    return base + "." + stem + ".wav";
+}
+
+}  // namespace
+
+int runAudioRender(int argc, char** argv) {
+    // argv[1] is --render-wav
+    if (argc < 4) return usage();
+    const std::string romPath = argv[2], outPath = argv[3];
+    double seconds = 120.0;
+    Resampler::Quality quality = Resampler::Quality::High;  // offline: no reason to skimp
+    AudioCapture capture;
+    for (int i = 4; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--stems") == 0) {
+            capture.stems = true;
+        } else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            capture.sampleRate = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--quality") == 0 && i + 1 < argc) {
+            const char* q = argv[++i];
+            if (std::strcmp(q, "low") == 0)
+                quality = Resampler::Quality::Low;
+            else if (std::strcmp(q, "medium") == 0)
+                quality = Resampler::Quality::Medium;
+            else if (std::strcmp(q, "high") == 0)
+                quality = Resampler::Quality::High;
+            else
+                return usage();
+        } else {
+            return usage();
+        }
+    }
+    if (seconds <= 0.0 || capture.sampleRate < 8000 || capture.sampleRate > 192000) return usage();
+
+    std::vector<std::string> paths{outPath};
+    if (capture.stems) {
+        for (int s = 0; s < APU::StemCount; ++s) paths.push_back(stemPath(outPath, APU::stemName((APU::Stem)s)));
+    }
+    WavWriter wav;
+    if (!wav.open(paths, capture.sampleRate)) {
+        std::fprintf(stderr, "render-wav: cannot create %s\n", outPath.c_str());
+        return 1;
+    }
+    capture.write = [&wav](int track, const int16_t* samples, int count) {
+        wav.write(track, samples, (size_t)count);
+    };
+
+    NES nes;
+    try {
+        if (!nes.loadROM(romPath)) throw std::runtime_error("failed to load " + romPath);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "render-wav: %s\n", e.what());
+        return 1;
+    }
+    nes.cart->batteryBacked = false;  // a render must not touch the player's save
+    nes.audioOnly = &capture;
+    nes.powerOn();
+    nes.apu->setQuality(quality);
+    PadState noButtons;
+    nes.input->source = &noButtons;
+
+    const uint64_t endCycle = (uint64_t)(seconds * APU::CPU_CLOCK);
+    auto t0 = std::chrono::steady_clock::now();
+    while (nes.scheduler.now < endCycle) nes.runFrame(/*compose=*/false);
+    double emulated = (double)nes.scheduler.now / APU::CPU_CLOCK;
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    uint64_t samples = wav.samplesWritten(0);
+
+    if (!wav.close()) {
+        std::fprintf(stderr, "render-wav: write error\n");
+        return 1;
+    }
+    std::printf("%s: %.1f s of audio (%llu samples @ %d Hz, %s) in %.2f s, %.0fx realtime\n", outPath.c_str(),
+                emulated, (unsigned long long)samples, capture.sampleRate, capture.stems ? "mix + 5 stems" : "mix",
+                wall, wall > 0.0 ? emulated / wall : 0.0);
+    return 0;
+}
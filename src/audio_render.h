@@ -0,0 +1,9 @@
+// audio_render.h
+#pragma once
+
+// Headless audio-only rendering to WAV, run from the command line:
+//   nes --render-wav <rom> <out.wav> [--seconds N] [--rate HZ] [--quality low|medium|high] [--stems]
+// Runs CPU, APU and mapper with the PPU reduced to frame/NMI timing, as fast
+// as the host allows. --stems also writes <out>.pulse1.wav, .pulse2, .tri,
+// .noise and .dmc. Returns the process exit code.
+int runAudioRender(int argc, char** argv);
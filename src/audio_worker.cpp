@@ -0,0 +1,128 @@
+// audio_worker.cpp
+#include "audio_worker.h"
+
+#include <utility>
+
+AudioWorker::AudioWorker() {
+    apu.mode = APU::Mode::Replay;
+    apu.sched = &sched;
+}
+
+void AudioWorker::start() {
+    if (thr.joinable()) return;
+    apu.init();
+    // Same power-on state as the emulation side's APU
+    sched.reset();
+    apu.resetFrameSequencer(/*fiveStep=*/false, /*inhibitIRQ=*/false, /*immediateClock=*/false);
+    quit = false;
+    thr = std::thread([this] { run(); });
+}
+
+void AudioWorker::stop() {
+    if (thr.joinable()) {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            quit = true;
+        }
+        cvWork.notify_one();
+        cvSpace.notify_all();
+        thr.join();
+    }
+    apu.shutdown();
+}
+
+void AudioWorker::push(Job&& job) {
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        cvSpace.wait(lk, [&] { return quit || jobs.size() < kMaxQueued; });
+        if (quit) return;
+        jobs.push_back(std::move(job));
+    }
+    cvWork.notify_one();
+}
+
+void AudioWorker::submitFrame(std::vector<ApuLogEntry>& frameLog, uint64_t endCycle) {
+    Job job;
+    job.kind = Job::Frame;
+    job.endCycle = endCycle;
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (!spare.empty()) {
+            job.log = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+    job.log.clear();
+    job.log.swap(frameLog);
+    push(std::move(job));
+}
+
+void AudioWorker::setSpeed(int factor) {
+    Job job;
+    job.kind = Job::Speed;
+    job.value = factor;
+    push(std::move(job));
+}
+
+void AudioWorker::setQuality(Resampler::Quality q) {
+    Job job;
+    job.kind = Job::Quality;
+    job.value = (int)q;
+    push(std::move(job));
+}
+
+void AudioWorker::run() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            cvWork.wait(lk, [&] { return quit || !jobs.empty(); });
+            if (quit) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        cvSpace.notify_one();
+
+        switch (job.kind) {
+            case Job::Frame:
+                replay(job);
+                break;
+            case Job::Speed:
+                apu.setSpeed(job.value);
+                break;
+            case Job::Quality:
+                apu.setQuality((Resampler::Quality)job.value);
+                break;
+        }
+
+        if (job.kind == Job::Frame) {
+            std::lock_guard<std::mutex> lk(mtx);
+            spare.push_back(std::move(job.log));
+        }
+    }
+}
+
+// Dispatch the replay APU's own sequencer/DMC events up to `until`, in the
+// same order NES::runFrame does on the emulation side
+void AudioWorker::runEvents(uint64_t until) {
+    sched.now = until;
+    Scheduler::Event ev;
+    uint64_t at;
+    while (sched.popDue(ev, at)) {
+        if (ev == Scheduler::ApuFrameSequencer) apu.frameSequencerEvent(at);
+        if (ev == Scheduler::ApuDmc) apu.dmcEvent(at);
+    }
+}
+
+void AudioWorker::replay(const Job& job) {
+    for (const ApuLogEntry& e : job.log) {
+        if (e.addr == ApuLogEntry::kDmcFetch) {
+            apu.dmcFeed.push_back(e.value);  // consumed when the replayed DMC reaches that fetch
+            continue;
+        }
+        runEvents(e.cycle);
+        apu.cpuWrite(e.addr, e.value);
+    }
+    runEvents(job.endCycle);
+    apu.endFrame();
+}
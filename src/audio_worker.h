@@ -0,0 +1,55 @@
+// audio_worker.h
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "apu.h"
+#include "resampler.h"
+#include "scheduler.h"
+
+// Runs channel stepping, mixing and resampling off the emulation thread.
+// The emulation-side APU (Mode::Track) hands over one register/DMC log per
+// frame; this thread replays it into its own APU (Mode::Replay), which owns
+// the audio device. Frames are replayed in order and never dropped: if the
+// worker falls far behind, submitFrame blocks.
+struct AudioWorker {
+    APU apu;  // Mode::Replay; read its ring/underrun stats from any thread
+
+    AudioWorker();
+    ~AudioWorker() { stop(); }
+    void start();  // opens the device
+    void stop();   // drains nothing, joins; safe to call twice
+
+    // Emulation thread
+    void submitFrame(std::vector<ApuLogEntry>& frameLog, uint64_t endCycle);  // swaps frameLog with an empty one
+    void setSpeed(int factor);
+    void setQuality(Resampler::Quality q);
+
+   private:
+    static constexpr size_t kMaxQueued = 8;  // frames
+
+    struct Job {
+        enum Kind { Frame, Speed, Quality } kind = Frame;
+        std::vector<ApuLogEntry> log;
+        uint64_t endCycle = 0;
+        int value = 0;
+    };
+
+    void run();
+    void push(Job&& job);
+    void replay(const Job& job);
+    void runEvents(uint64_t until);
+
+    Scheduler sched;  // the replay timeline; mirrors the emulation thread's
+
+    std::thread thr;
+    std::mutex mtx;
+    std::condition_variable cvWork, cvSpace;
+    std::deque<Job> jobs;
+    std::vector<std::vector<ApuLogEntry>> spare;  // recycled log buffers
+    bool quit = false;
+};
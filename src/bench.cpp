@@ -0,0 +1,468 @@
+// bench.cpp
+#include "bench.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "compositor.h"
+#include "mapper_mmc1.h"
+#include "mapper_mmc3.h"
+#include "ntsc_filter.h"
+#include "palette.h"
+#include "ppu.h"
+#include "resampler.h"
+#include "rom_hash.h"
+#include "scaler.h"
+#include "thread_pool.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 96 kHz synthesis -> 48 kHz device, one NTSC frame per call like the APU does
+int benchResampler() {
+    const double inRate = 96000.0, outRate = 48000.0;
+    const int frameIn = 1600;  // ~1/60 s of input
+    const int frames = 20000;
+
+    std::vector<int16_t> in(frameIn);
+    uint32_t lfsr = 0x12345678u;
+    for (int i = 0; i < frameIn; ++i) {
+        lfsr = lfsr * 1664525u + 1013904223u;
+        in[i] = (int16_t)((i / 40 % 2 ? 6000 : -6000) + (int)(lfsr >> 22) - 512);  // square + noise
+    }
+    std::vector<int16_t> out(frameIn);
+
+    std::printf("resampler: %.0f Hz -> %.0f Hz, %d-sample frames\n", inRate, outRate, frameIn);
+    std::printf("  %-7s %-7s %5s %12s\n", "quality", "isa", "taps", "ns/sample");
+    const Resampler::Quality tiers[] = {Resampler::Quality::Low, Resampler::Quality::Medium, Resampler::Quality::High};
+    const char* tierNames[] = {"low", "medium", "high"};
+    const Resampler::Isa isas[] = {Resampler::Isa::Scalar, Resampler::Isa::SSE2, Resampler::Isa::AVX2};
+    for (int t = 0; t < 3; ++t) {
+        for (Resampler::Isa isa : isas) {
+            Resampler rs;
+            rs.init(inRate, outRate, tiers[t]);
+            rs.forceIsa(isa);
+            if (rs.isa() != isa) continue;  // not available on this CPU
+
+            uint64_t produced = 0;
+            volatile int16_t sink = 0;  // keeps the output live
+            auto t0 = Clock::now();
+            for (int f = 0; f < frames; ++f) {
+                int n = rs.process(in.data(), frameIn, out.data(), (int)out.size());
+                produced += (uint64_t)n;
+                sink = out[(size_t)n / 2];
+            }
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+            (void)sink;
+            std::printf("  %-7s %-7s %5d %12.2f\n", tierNames[t], Resampler::isaName(isa), rs.taps(),
+                        ns / (double)produced);
+        }
+    }
+    return 0;
+}
+
+// One PPU scanline through each compositor path, checked against the scalar one
+int benchCompositor() {
+    const int lines = 4096;  // distinct random lines, cycled
+    const int passes = 200;
+
+    // Mostly opaque BG with sparse sprites, like a typical playfield
+    std::vector<uint16_t> pix((size_t)lines * Compositor::kWidth);
+    std::vector<Compositor::LineState> states(lines);
+    uint32_t lfsr = 0x2545F491u;
+    auto rnd = [&] {
+        lfsr = lfsr * 1664525u + 1013904223u;
+        return lfsr >> 8;
+    };
+    for (int l = 0; l < lines; ++l) {
+        Compositor::LineState& st = states[l];
+        uint32_t m = rnd();
+        st.universal = (uint8_t)(m & 0x3F);
+        st.showBG = (m & 0x0700) != 0;
+        st.showSP = (m & 0x3800) != 0;
+        st.bgLeft8 = (m & 0x4000) != 0;
+        st.spLeft8 = (m & 0x8000) != 0;
+        for (int x = 0; x < Compositor::kWidth; ++x) {
+            uint32_t r = rnd();
+            uint16_t v = (r & 3) ? (uint16_t)((r >> 2 & 0x3F) | LinePixel::kBgOpaque) : st.universal;
+            if ((r >> 8 & 7) == 0) {
+                v |= (uint16_t)(((r >> 11 & 0x3F) << LinePixel::kSpColorShift) | LinePixel::kSpOpaque);
+                if (r & (1u << 17)) v |= LinePixel::kSpBehind;
+                if ((r >> 18 & 15) == 0) v |= LinePixel::kSprite0;
+            }
+            pix[(size_t)l * Compositor::kWidth + x] = v;
+        }
+    }
+
+    Compositor ref;
+    ref.forceIsa(Compositor::Isa::Scalar);
+    std::vector<uint8_t> want((size_t)lines * Compositor::kWidth), got(Compositor::kWidth);
+    std::vector<uint8_t> wantHit(lines);
+    for (int l = 0; l < lines; ++l) {
+        const uint16_t* line = &pix[(size_t)l * Compositor::kWidth];
+        wantHit[l] = ref.compose(line, states[l], &want[(size_t)l * Compositor::kWidth]);
+    }
+
+    std::printf("compositor: %d-pixel lines, %d random line states\n", Compositor::kWidth, lines);
+    std::printf("  %-7s %12s %12s\n", "isa", "ns/line", "ns/line hit");
+    const Compositor::Isa isas[] = {Compositor::Isa::Scalar, Compositor::Isa::SSE41, Compositor::Isa::AVX2};
+    for (Compositor::Isa isa : isas) {
+        Compositor c;
+        c.forceIsa(isa);
+        if (c.isa() != isa) continue;  // not available on this CPU
+
+        for (int l = 0; l < lines; ++l) {
+            const uint16_t* line = &pix[(size_t)l * Compositor::kWidth];
+            bool hit = c.compose(line, states[l], got.data());
+            bool hitOnly = c.spriteZeroHit(line, states[l]);
+            if (hit != (bool)wantHit[l] || hitOnly != (bool)wantHit[l] ||
+                std::memcmp(got.data(), &want[(size_t)l * Compositor::kWidth], got.size()) != 0) {
+                std::printf("  %-7s MISMATCH on line %d\n", Compositor::isaName(isa), l);
+                return 1;
+            }
+        }
+
+        volatile int sink = 0;
+        auto t0 = Clock::now();
+        for (int p = 0; p < passes; ++p)
+            for (int l = 0; l < lines; ++l)
+                sink = sink + c.compose(&pix[(size_t)l * Compositor::kWidth], states[l], got.data());
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        t0 = Clock::now();
+        for (int p = 0; p < passes; ++p)
+            for (int l = 0; l < lines; ++l) sink = sink + c.spriteZeroHit(&pix[(size_t)l * Compositor::kWidth], states[l]);
+        double nsHit = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        (void)sink;
+        std::printf("  %-7s %12.1f %12.1f\n", Compositor::isaName(isa), ns / ((double)passes * lines),
+                    nsHit / ((double)passes * lines));
+    }
+    return 0;
+}
+
+// Index-to-ARGB expansion of whole frames through each palette path
+int benchPalette() {
+    const int frames = 16;  // distinct random frames, cycled
+    const int passes = 50;
+    const int pixels = PPU::WIDTH * PPU::HEIGHT;
+
+    std::vector<uint8_t> idx((size_t)frames * pixels), emph((size_t)frames * PPU::HEIGHT);
+    uint32_t lfsr = 0x9E3779B9u;
+    auto rnd = [&] {
+        lfsr = lfsr * 1664525u + 1013904223u;
+        return lfsr >> 8;
+    };
+    for (uint8_t& i : idx) i = (uint8_t)(rnd() & 0x3F);
+    for (size_t l = 0; l < emph.size(); ++l) emph[l] = (rnd() & 3) ? 0 : (uint8_t)rnd();
+
+    // Reference: straight table lookups
+    const Palette& pal = Palette::ntsc();
+    std::vector<uint32_t> want((size_t)frames * pixels), got(pixels);
+    for (int f = 0; f < frames; ++f)
+        for (int p = 0; p < pixels; ++p)
+            want[(size_t)f * pixels + p] = pal.color(emph[(size_t)f * PPU::HEIGHT + p / PPU::WIDTH],
+                                                     idx[(size_t)f * pixels + p]);
+
+    std::printf("palette: %dx%d frames, %d random frames\n", PPU::WIDTH, PPU::HEIGHT, frames);
+    std::printf("  %-7s %12s %12s\n", "isa", "us/frame", "Mpixel/s");
+    const Palette::Isa isas[] = {Palette::Isa::Scalar, Palette::Isa::SSE41, Palette::Isa::AVX2};
+    for (Palette::Isa isa : isas) {
+        Palette p(PPU::kNesPalette.data());
+        p.forceIsa(isa);
+        if (p.isa() != isa) continue;  // not available on this CPU
+
+        for (int f = 0; f < frames; ++f) {
+            p.expandFrame(&idx[(size_t)f * pixels], &emph[(size_t)f * PPU::HEIGHT], got.data(),
+                          PPU::WIDTH * sizeof(uint32_t));
+            if (std::memcmp(got.data(), &want[(size_t)f * pixels], got.size() * sizeof(uint32_t)) != 0) {
+                std::printf("  %-7s MISMATCH in frame %d\n", Palette::isaName(isa), f);
+                return 1;
+            }
+        }
+
+        auto t0 = Clock::now();
+        for (int n = 0; n < passes; ++n)
+            for (int f = 0; f < frames; ++f)
+                p.expandFrame(&idx[(size_t)f * pixels], &emph[(size_t)f * PPU::HEIGHT], got.data(),
+                              PPU::WIDTH * sizeof(uint32_t));
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / ((double)passes * frames);
+        std::printf("  %-7s %12.1f %12.1f\n", Palette::isaName(isa), us, pixels / us);
+    }
+    return 0;
+}
+
+// NTSC filter over random frames: each ISA against the scalar one, then banded across a pool
+int benchNtsc() {
+    const int frames = 8;  // distinct random frames, cycled
+    const int passes = 10;
+    const int pixels = PPU::WIDTH * PPU::HEIGHT;
+    const int outPixels = NtscFilter::kOutWidth * PPU::HEIGHT;
+    const int pitch = NtscFilter::kOutWidth * (int)sizeof(uint32_t);
+
+    // Runs of one color, like tiles, with the odd emphasized line
+    std::vector<uint8_t> idx((size_t)frames * pixels), emph((size_t)frames * PPU::HEIGHT);
+    uint32_t lfsr = 0x6A09E667u;
+    auto rnd = [&] {
+        lfsr = lfsr * 1664525u + 1013904223u;
+        return lfsr >> 8;
+    };
+    for (size_t i = 0; i < idx.size(); i += 4) std::memset(&idx[i], (int)(rnd() & 0x3F), 4);
+    for (uint8_t& e : emph) e = (rnd() & 7) ? 0 : (uint8_t)(rnd() & 7);
+
+    NtscFilter ref;
+    ref.forceIsa(NtscFilter::Isa::Scalar);
+    std::vector<uint32_t> want((size_t)frames * outPixels), got(outPixels);
+    for (int f = 0; f < frames; ++f)
+        ref.renderFrame(&idx[(size_t)f * pixels], &emph[(size_t)f * PPU::HEIGHT], (uint64_t)f,
+                        &want[(size_t)f * outPixels], pitch);
+
+    ThreadPool pool;
+    std::printf("ntsc: %dx%d frames to %dx%d, %d random frames, pool of %d threads\n", PPU::WIDTH, PPU::HEIGHT,
+                NtscFilter::kOutWidth, PPU::HEIGHT, frames, pool.threads());
+    std::printf("  %-7s %12s %12s\n", "isa", "ms/frame", "ms pooled");
+    const NtscFilter::Isa isas[] = {NtscFilter::Isa::Scalar, NtscFilter::Isa::SSE2, NtscFilter::Isa::AVX2};
+    NtscFilter n;
+    for (NtscFilter::Isa isa : isas) {
+        n.forceIsa(isa);
+        if (n.isa() != isa) continue;  // not available on this CPU
+
+        for (int f = 0; f < frames; ++f) {
+            n.renderFrame(&idx[(size_t)f * pixels], &emph[(size_t)f * PPU::HEIGHT], (uint64_t)f, got.data(), pitch,
+                          &pool);
+            if (std::memcmp(got.data(), &want[(size_t)f * outPixels], got.size() * sizeof(uint32_t)) != 0) {
+                std::printf("  %-7s MISMATCH in frame %d\n", NtscFilter::isaName(isa), f);
+                return 1;
+            }
+        }
+
+        double ms[2];
+        for (int pooled = 0; pooled < 2; ++pooled) {
+            auto t0 = Clock::now();
+            for (int p = 0; p < passes; ++p)
+                for (int f = 0; f < frames; ++f)
+                    n.renderFrame(&idx[(size_t)f * pixels], &emph[(size_t)f * PPU::HEIGHT], (uint64_t)f, got.data(),
+                                  pitch, pooled ? &pool : nullptr);
+            ms[pooled] = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / ((double)passes * frames);
+        }
+        std::printf("  %-7s %12.3f %12.3f\n", NtscFilter::isaName(isa), ms[0], ms[1]);
+    }
+    return 0;
+}
+
+// Pixel-art scalers on an emulated-looking frame: each ISA against the scalar one, alone and pooled
+int benchScalers() {
+    const int passes = 40;
+    const int pixels = PPU::WIDTH * PPU::HEIGHT;
+
+    // 8x8 tiles of a few colors with diagonal edges, so every rule fires
+    std::vector<uint32_t> in(pixels);
+    for (int y = 0; y < PPU::HEIGHT; ++y)
+        for (int x = 0; x < PPU::WIDTH; ++x) {
+            int tile = (x / 8 * 7 + y / 8 * 13) % 5;
+            int c = (x % 8 > y % 8) ? tile : (tile + ((x + y) % 3)) % 5;
+            in[(size_t)y * PPU::WIDTH + x] = PPU::kNesPalette[(size_t)(c * 9 + 0x11) & 0x3F];
+        }
+
+    ThreadPool pool;
+    std::printf("scalers: %dx%d frame, pool of %d threads\n", PPU::WIDTH, PPU::HEIGHT, pool.threads());
+    std::printf("  %-9s %-7s %12s %12s\n", "scaler", "isa", "ms/frame", "ms pooled");
+    const Scaler::Kind kinds[] = {Scaler::Kind::Scale2x, Scaler::Kind::Scale3x, Scaler::Kind::XbrLite};
+    const Scaler::Isa isas[] = {Scaler::Isa::Scalar, Scaler::Isa::SSE2};
+    for (Scaler::Kind kind : kinds) {
+        Scaler s(kind);
+        const int n = s.factor();
+        const int pitch = PPU::WIDTH * n * (int)sizeof(uint32_t);
+        std::vector<uint32_t> want((size_t)pixels * n * n), got(want.size());
+        s.forceIsa(Scaler::Isa::Scalar);
+        s.scale(in.data(), want.data(), pitch);
+
+        for (Scaler::Isa isa : isas) {
+            s.forceIsa(isa);
+            if (s.isa() != isa) continue;  // not available on this CPU
+            s.scale(in.data(), got.data(), pitch, &pool);
+            if (got != want) {
+                std::printf("  %-9s %-7s MISMATCH\n", Scaler::name(kind), Scaler::isaName(isa));
+                return 1;
+            }
+            double ms[2];
+            for (int pooled = 0; pooled < 2; ++pooled) {
+                auto t0 = Clock::now();
+                for (int p = 0; p < passes; ++p) s.scale(in.data(), got.data(), pitch, pooled ? &pool : nullptr);
+                ms[pooled] = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / passes;
+            }
+            std::printf("  %-9s %-7s %12.3f %12.3f\n", Scaler::name(kind), Scaler::isaName(isa), ms[0], ms[1]);
+        }
+    }
+    return 0;
+}
+
+// Mapper reads through the resolved bank slots against the per-access bank
+// arithmetic they replaced (still there as prgOffset/chrOffset, which build
+// the slots), over random bank setups
+template <typename M>
+int benchMapperReads(const char* name, M& m, void (*randomize)(M&, uint32_t&)) {
+    const int setups = 64, reads = 1 << 16;
+    uint32_t lfsr = 0xC0FFEEu;
+    auto next = [&] { return lfsr = lfsr * 1664525u + 1013904223u; };
+    std::vector<uint16_t> prgAddr(reads), chrAddr(reads);
+    for (int i = 0; i < reads; ++i) {
+        prgAddr[i] = (uint16_t)(0x8000 | (next() >> 17));
+        chrAddr[i] = (uint16_t)((next() >> 19) & 0x1FFF);
+    }
+    const RomSpan chr = m.chr;
+
+    double ns[2][2] = {};  // [prg/chr][before/after]
+    Mapper& bus = m;       // reads go through the vtable, as Cartridge does
+    volatile uint32_t sink = 0;
+    for (int s = 0; s < setups; ++s) {
+        randomize(m, lfsr);
+        for (uint32_t a = 0x8000; a <= 0xFFFF; ++a)
+            if (bus.cpuRead((uint16_t)a) != m.prg[m.prgOffset((uint16_t)a)]) {
+                std::printf("  %-6s PRG MISMATCH at $%04X\n", name, a);
+                return 1;
+            }
+        for (uint32_t a = 0; a < 0x2000; ++a)
+            if (bus.ppuRead((uint16_t)a) != chr[m.chrOffset((uint16_t)a)]) {
+                std::printf("  %-6s CHR MISMATCH at $%04X\n", name, a);
+                return 1;
+            }
+
+        uint32_t acc = 0;
+        auto t0 = Clock::now();
+        for (uint16_t a : prgAddr) acc += m.prg[m.prgOffset(a)];
+        auto t1 = Clock::now();
+        for (uint16_t a : prgAddr) acc += bus.cpuRead(a);
+        auto t2 = Clock::now();
+        for (uint16_t a : chrAddr) acc += chr[m.chrOffset(a)];
+        auto t3 = Clock::now();
+        for (uint16_t a : chrAddr) acc += bus.ppuRead(a);
+        auto t4 = Clock::now();
+        sink = acc;
+        ns[0][0] += std::chrono::duration<double, std::nano>(t1 - t0).count();
+        ns[0][1] += std::chrono::duration<double, std::nano>(t2 - t1).count();
+        ns[1][0] += std::chrono::duration<double, std::nano>(t3 - t2).count();
+        ns[1][1] += std::chrono::duration<double, std::nano>(t4 - t3).count();
+    }
+    (void)sink;
+    const double n = (double)setups * reads;
+    std::printf("  %-6s %-4s %12.2f %12.2f\n", name, "PRG", ns[0][0] / n, ns[0][1] / n);
+    std::printf("  %-6s %-4s %12.2f %12.2f\n", name, "CHR", ns[1][0] / n, ns[1][1] / n);
+    return 0;
+}
+
+std::vector<uint8_t> randomBytes(size_t n, uint32_t seed) {
+    std::vector<uint8_t> v(n);
+    for (uint8_t& b : v) b = (uint8_t)((seed = seed * 1664525u + 1013904223u) >> 24);
+    return v;
+}
+
+int benchMappers() {
+    std::printf("mappers: random bank setups, ns per read\n");
+    std::printf("  %-6s %-4s %12s %12s\n", "mapper", "bus", "arithmetic", "slots");
+
+    const std::vector<uint8_t> prg1 = randomBytes(256 * 1024, 1), chr1 = randomBytes(128 * 1024, 2);
+    MapperMMC1 mmc1(prg1, chr1, 0, 0, 8);
+    auto mmc1Setup = [](MapperMMC1& m, uint32_t& r) {
+        for (uint16_t reg = 0x8000; reg != 0; reg = (uint16_t)(reg + 0x2000)) {
+            r = r * 1664525u + 1013904223u;
+            const uint8_t v = (uint8_t)(r >> 24);
+            for (int bit = 0; bit < 5; ++bit) m.cpuWrite(reg, (uint8_t)((v >> bit) & 1));
+        }
+    };
+    if (benchMapperReads<MapperMMC1>("MMC1", mmc1, mmc1Setup)) return 1;
+
+    const std::vector<uint8_t> prg3 = randomBytes(512 * 1024, 3), chr3 = randomBytes(256 * 1024, 4);
+    MapperMMC3 mmc3(prg3, chr3, 0, 0, 8);
+    auto mmc3Setup = [](MapperMMC3& m, uint32_t& r) {
+        for (uint8_t reg = 0; reg < 8; ++reg) {
+            r = r * 1664525u + 1013904223u;
+            m.cpuWrite(0x8000, (uint8_t)((r >> 24) & 0xC0) | reg);
+            m.cpuWrite(0x8001, (uint8_t)(r >> 16));
+        }
+    };
+    return benchMapperReads<MapperMMC3>("MMC3", mmc3, mmc3Setup);
+}
+
+// ROM hashing for the database lookup: each ISA against the scalar digest
+// over a 1 MiB image (the largest licensed carts), with odd split points
+int benchRomHash() {
+    const std::vector<uint8_t> rom = randomBytes(1 << 20, 5);
+    const int passes = 20;
+    const size_t split = 0x2000 * 37 + 13;  // PRG/CHR boundary not on a block edge
+
+    std::printf("romhash: %zu KiB, ms per image\n", rom.size() / 1024);
+    std::printf("  %-6s %-7s %12s %12s\n", "hash", "isa", "ms", "MB/s");
+    uint32_t wantCrc = 0;
+    for (Crc32::Isa isa : {Crc32::Isa::Scalar, Crc32::Isa::PCLMUL}) {
+        Crc32 probe;
+        probe.forceIsa(isa);
+        if (probe.isa() != isa) continue;  // not available on this CPU
+        uint32_t got = 0;
+        auto t0 = Clock::now();
+        for (int p = 0; p < passes; ++p) {
+            Crc32 c;
+            c.forceIsa(isa);
+            c.update(rom.data(), split);
+            c.update(rom.data() + split, rom.size() - split);
+            got = c.value();
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / passes;
+        if (isa == Crc32::Isa::Scalar) wantCrc = got;
+        if (got != wantCrc) {
+            std::printf("  %-6s %-7s MISMATCH\n", "CRC-32", Crc32::isaName(isa));
+            return 1;
+        }
+        std::printf("  %-6s %-7s %12.3f %12.0f\n", "CRC-32", Crc32::isaName(isa), ms, rom.size() / ms / 1000.0);
+    }
+    uint8_t wantSha[20] = {};
+    for (Sha1::Isa isa : {Sha1::Isa::Scalar, Sha1::Isa::SHA}) {
+        Sha1 probe;
+        probe.forceIsa(isa);
+        if (probe.isa() != isa) continue;
+        uint8_t got[20];
+        auto t0 = Clock::now();
+        for (int p = 0; p < passes; ++p) {
+            Sha1 s;
+            s.forceIsa(isa);
+            s.update(rom.data(), split);
+            s.update(rom.data() + split, rom.size() - split);
+            s.finish(got);
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / passes;
+        if (isa == Sha1::Isa::Scalar) std::memcpy(wantSha, got, 20);
+        if (std::memcmp(got, wantSha, 20) != 0) {
+            std::printf("  %-6s %-7s MISMATCH\n", "SHA-1", Sha1::isaName(isa));
+            return 1;
+        }
+        std::printf("  %-6s %-7s %12.3f %12.0f\n", "SHA-1", Sha1::isaName(isa), ms, rom.size() / ms / 1000.0);
+    }
+    return 0;
+}
+
+struct Entry {
+    const char* name;
+    int (*fn)();
+};
+const Entry kBenches[] = {
+    {"resampler", &benchResampler},
+    {"compositor", &benchCompositor},
+    {"palette", &benchPalette},
+    {"ntsc", &benchNtsc},
+    {"scalers", &benchScalers},
+    {"mappers", &benchMappers},
+    {"romhash", &benchRomHash},
+};
+
+}  // namespace
+
+int runBenchmark(const char* name) {
+    for (const Entry& e : kBenches) {
+        if (name && std::strcmp(name, e.name) == 0) return e.fn();
+    }
+    std::fprintf(stderr, "usage: nes --bench <name>\navailable:");
+    for (const Entry& e : kBenches) std::fprintf(stderr, " %s", e.name);
+    std::fprintf(stderr, "\n");
+    return name ? 1 : 0;
+}
@@ -0,0 +1,7 @@
+// bench.h
+#pragma once
+
+// Micro-benchmarks for hot paths, run from the command line instead of the UI:
+//   nes --bench <name>      (no name lists them)
+// Returns the process exit code.
+int runBenchmark(const char* name);
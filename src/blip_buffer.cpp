@@ -0,0 +1,72 @@
+// blip_buffer.cpp
+#include "blip_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void BlipBuffer::init(double maxRatio, uint32_t maxClocks) {
+    buf.assign((size_t)std::ceil(maxRatio * maxClocks) + kTaps + 2, 0);
+    setRatio(maxRatio);
+    clear();
+
+    // Windowed-sinc impulse (Blackman, cutoff at 0.45 fs) for every sub-sample phase.
+    // Each phase is normalized to sum exactly to 1 << kKernelBits so integrating
+    // a step always lands on the exact new amplitude.
+    const double pi = 3.14159265358979323846;
+    const double cutoff = 0.9;
+    for (int p = 0; p < kPhases; ++p) {
+        double tap[kTaps];
+        double sum = 0.0;
+        for (int i = 0; i < kTaps; ++i) {
+            double x = i + 0.5 - kHalfWidth - (double)p / kPhases;
+            double s = (x == 0.0) ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+            double w = 0.42 + 0.5 * std::cos(pi * x / kHalfWidth) + 0.08 * std::cos(2.0 * pi * x / kHalfWidth);
+            tap[i] = s * w;
+            sum += tap[i];
+        }
+        int total = 0, peak = 0;
+        for (int i = 0; i < kTaps; ++i) {
+            kernel[p][i] = (int16_t)std::lround(tap[i] / sum * (1 << kKernelBits));
+            total += kernel[p][i];
+            if (kernel[p][i] > kernel[p][peak]) peak = i;
+        }
+        kernel[p][peak] = (int16_t)(kernel[p][peak] + ((1 << kKernelBits) - total));
+    }
+}
+
+void BlipBuffer::setRatio(double ratio) {
+    factor = (uint64_t)std::llround(ratio * (double)(1ull << kFracBits));
+}
+
+void BlipBuffer::clear() {
+    std::fill(buf.begin(), buf.end(), 0);
+    offset = 0;
+    integrator = 0;
+}
+
+void BlipBuffer::endFrame(uint32_t clocks) {
+    offset += (uint64_t)clocks * factor;
+}
+
+int BlipBuffer::readSamples(int16_t* out, int maxSamples) {
+    int avail = samplesAvail();
+    int n = std::min(avail, maxSamples);
+    if (n <= 0) return 0;
+
+    int32_t sum = integrator;
+    for (int i = 0; i < n; ++i) {
+        int32_t s = sum >> kKernelBits;
+        sum += buf[i];
+        out[i] = (int16_t)std::clamp<int32_t>(s, INT16_MIN, INT16_MAX);
+        sum -= s << (kKernelBits - kBassShift);  // leak towards zero: DC blocker
+    }
+    integrator = sum;
+
+    // Slide the unread samples and the pending kernel tails down to the front
+    size_t live = (size_t)(avail - n) + kTaps;
+    std::memmove(buf.data(), buf.data() + n, live * sizeof(int32_t));
+    std::fill(buf.begin() + live, buf.begin() + live + n, 0);
+    offset -= (uint64_t)n << kFracBits;
+    return n;
+}
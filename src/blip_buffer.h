@@ -0,0 +1,46 @@
+// blip_buffer.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Band-limited step synthesis.
+// Callers report amplitude *changes* at clock timestamps within the current
+// frame; each change is spread over a few output samples with a windowed-sinc
+// kernel. endFrame() advances time, readSamples() integrates the deltas into
+// PCM. A leaky integrator doubles as the DC-blocking high-pass of the console.
+struct BlipBuffer {
+    static constexpr int kHalfWidth = 8;  // kernel taps on each side of a step
+    static constexpr int kTaps = kHalfWidth * 2;
+    static constexpr int kPhaseBits = 6;  // sub-sample step positions
+    static constexpr int kPhases = 1 << kPhaseBits;
+    static constexpr int kKernelBits = 14;  // kernel phases sum to 1 << kKernelBits
+    static constexpr int kBassShift = 10;   // high-pass corner ~15 Hz at SYNTH_RATE (96 kHz)
+
+    // Room for maxClocks of input per frame at the given output/clock ratio
+    void init(double maxRatio, uint32_t maxClocks);
+    // Output samples per input clock; takes effect for the next frame
+    void setRatio(double ratio);
+    void clear();
+
+    // Amplitude change of `delta` at `clock` (relative to the start of the frame)
+    void addDelta(uint32_t clock, int delta) {
+        uint64_t pos = offset + (uint64_t)clock * factor;
+        int32_t* out = &buf[(size_t)(pos >> kFracBits)];
+        const int16_t* k = kernel[(pos >> (kFracBits - kPhaseBits)) & (kPhases - 1)];
+        for (int i = 0; i < kTaps; ++i) out[i] += k[i] * delta;
+    }
+
+    void endFrame(uint32_t clocks);  // closes the frame; new timestamps start at 0
+    int samplesAvail() const { return (int)(offset >> kFracBits); }
+    int readSamples(int16_t* out, int maxSamples);
+
+   private:
+    static constexpr int kFracBits = 32;
+
+    uint64_t factor = 0;  // output samples per clock, 32.32 fixed point
+    uint64_t offset = 0;  // start of the current frame in output samples, 32.32
+    int32_t integrator = 0;
+    std::vector<int32_t> buf;
+    int16_t kernel[kPhases][kTaps]{};
+};
@@ -38,6 +38,14 @@ uint8_t Bus::cpuRead(uint16_t a){
     }
 }
 
+const uint8_t* Bus::readPage(uint8_t page){
+    uint16_t a = (uint16_t)page << 8;
+    if(a < 0x2000) return &sysRAM[a & 0x07FF];
+    // $4000-$40FF mixes APU/IO registers with cartridge space
+    if(a >= 0x4100) return cart ? cart->cpuReadPage(a) : nullptr;
+    return nullptr;
+}
+
 void Bus::cpuWrite(uint16_t a, uint8_t v){
     if(a < 0x2000){
         sysRAM[a & 0x07FF] = v;
@@ -51,8 +59,15 @@ void Bus::cpuWrite(uint16_t a, uint8_t v){
         // Stall CPU for 513 or 514 cycles
         cpu->dma_stall_cycles += 513 + (cpu_on_odd ? 1 : 0);
 
-        // Perform the copy functionally now
-        ppu->oamDMA([&](uint8_t i){ return cpuRead(base + i); });
+        // Perform the copy functionally now: straight from memory, or byte by
+        // byte through the registers for I/O pages
+        if(const uint8_t* page = readPage(v)){
+            ppu->oamDMA(page);
+        }else{
+            uint8_t buf[256];
+            for(int i = 0; i < 256; i++) buf[i] = cpuRead((uint16_t)(base + i));
+            ppu->oamDMA(buf);
+        }
     }else if(a == 0x4016){
         // Controller strobe
         if(input) input->setStrobe(v);
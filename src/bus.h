@@ -19,6 +19,8 @@ struct Bus {
     // CPU-visible memory map
     uint8_t cpuRead (uint16_t a);
     void    cpuWrite(uint16_t a, uint8_t v);
+    // Host pointer to CPU page `page` if it is plain memory (RAM, PRG), else nullptr
+    const uint8_t* readPage(uint8_t page);
 
     // IRQ lines from subsystems
     bool mapperIRQ();
@@ -6,20 +6,26 @@
 #include <string>
 
 struct Mapper;
+class RomImage;
 
 struct Cartridge {
+    std::shared_ptr<const RomImage> rom;  // the mapper reads PRG/CHR-ROM from it in place
     std::shared_ptr<Mapper> mapper;
 
-    uint8_t mapperId=0;
+    uint16_t mapperId=0;
     uint8_t mirroring=0;     // cached (0=horiz,1=vert)
     bool    batteryBacked=false;
+    bool    headerFromDb=false;  // header fields corrected by the ROM database
     std::string romPath;
 
     static std::shared_ptr<Cartridge> loadFromFile(const std::string& path);
+    // Image that did not come from a ROM file: no save file
+    static std::shared_ptr<Cartridge> fromImage(std::shared_ptr<const RomImage> image);
 
     // CPU/PPU bus
     uint8_t cpuRead(uint16_t a);
     void    cpuWrite(uint16_t a, uint8_t v);
+    const uint8_t* cpuReadPage(uint16_t a);  // see Mapper::cpuReadPage
     uint8_t ppuRead(uint16_t a);
     void    ppuWrite(uint16_t a, uint8_t v);
 
@@ -0,0 +1,168 @@
+// compositor.cpp
+#include "compositor.h"
+
+#include "cpu_features.h"
+
+#ifdef NES_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr int kWidth = Compositor::kWidth;
+using LineState = Compositor::LineState;
+
+// ===== Scalar (reference) =====
+template <bool kOut>
+bool composeScalar(const uint16_t* line, const LineState& st, uint8_t* out) {
+    bool hit = false;
+    for (int x = 0; x < kWidth; ++x) {
+        const uint16_t v = line[x];
+        const bool bgOn = st.showBG && (st.bgLeft8 || x >= 8);
+        const bool spOn = st.showSP && (st.spLeft8 || x >= 8);
+        const bool bgOpaque = bgOn && (v & LinePixel::kBgOpaque);
+        const bool spOpaque = spOn && (v & LinePixel::kSpOpaque);
+        if ((v & LinePixel::kSprite0) && bgOpaque && spOpaque) hit = true;
+        if (kOut) {
+            uint8_t idx = bgOn ? (uint8_t)(v & LinePixel::kBgColor) : st.universal;
+            if (spOpaque && (!(v & LinePixel::kSpBehind) || !bgOpaque))
+                idx = (uint8_t)((v & LinePixel::kSpColor) >> LinePixel::kSpColorShift);
+            out[x] = idx;
+        }
+    }
+    return hit;
+}
+
+#ifdef NES_X86
+// ===== SSE4.1: 16 pixels per step =====
+// Priority mux on 8 x u16 lanes. `bgEn`/`spEn` are the per-lane layer enables
+// (PPUMASK show bits with the left-8 masks folded in).
+struct MuxConstsSSE {
+    __m128i bgColor, bgOpaque, sprite0, spOpaque, behind, universal;
+};
+
+NES_TARGET_SSE41 inline __m128i muxSSE41(__m128i v, __m128i bgEn, __m128i spEn, const MuxConstsSSE& k,
+                                          __m128i& hit) {
+    __m128i bgOp = _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(v, k.bgOpaque), k.bgOpaque), bgEn);
+    __m128i spOp = _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(v, k.spOpaque), k.spOpaque), spEn);
+    __m128i s0 = _mm_cmpeq_epi16(_mm_and_si128(v, k.sprite0), k.sprite0);
+    hit = _mm_or_si128(hit, _mm_and_si128(s0, _mm_and_si128(bgOp, spOp)));
+    __m128i behind = _mm_cmpeq_epi16(_mm_and_si128(v, k.behind), k.behind);
+    __m128i useSp = _mm_andnot_si128(_mm_and_si128(behind, bgOp), spOp);
+    __m128i bgCol = _mm_blendv_epi8(k.universal, _mm_and_si128(v, k.bgColor), bgEn);
+    __m128i spCol = _mm_and_si128(_mm_srli_epi16(v, LinePixel::kSpColorShift), k.bgColor);
+    return _mm_blendv_epi8(bgCol, spCol, useSp);
+}
+
+template <bool kOut>
+NES_TARGET_SSE41 bool composeSSE41(const uint16_t* line, const LineState& st, uint8_t* out) {
+    MuxConstsSSE k;
+    k.bgColor = _mm_set1_epi16(LinePixel::kBgColor);
+    k.bgOpaque = _mm_set1_epi16(LinePixel::kBgOpaque);
+    k.sprite0 = _mm_set1_epi16(LinePixel::kSprite0);
+    k.spOpaque = _mm_set1_epi16(LinePixel::kSpOpaque);
+    k.behind = _mm_set1_epi16((int16_t)LinePixel::kSpBehind);
+    k.universal = _mm_set1_epi16(st.universal);
+    const __m128i bgEn = _mm_set1_epi16(st.showBG ? -1 : 0);
+    const __m128i spEn = _mm_set1_epi16(st.showSP ? -1 : 0);
+    const __m128i bgEnLeft = st.bgLeft8 ? bgEn : _mm_setzero_si128();  // pixels 0-7
+    const __m128i spEnLeft = st.spLeft8 ? spEn : _mm_setzero_si128();
+
+    __m128i hit = _mm_setzero_si128();
+    for (int x = 0; x < kWidth; x += 16) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(line + x);
+        __m128i a = muxSSE41(_mm_loadu_si128(in), x ? bgEn : bgEnLeft, x ? spEn : spEnLeft, k, hit);
+        __m128i b = muxSSE41(_mm_loadu_si128(in + 1), bgEn, spEn, k, hit);
+        if (kOut) _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(a, b));
+    }
+    return !_mm_testz_si128(hit, hit);
+}
+
+// ===== AVX2: 32 pixels per step =====
+struct MuxConstsAVX {
+    __m256i bgColor, bgOpaque, sprite0, spOpaque, behind, universal;
+};
+
+NES_TARGET_AVX2 inline __m256i muxAVX2(__m256i v, __m256i bgEn, __m256i spEn, const MuxConstsAVX& k,
+                                        __m256i& hit) {
+    __m256i bgOp = _mm256_and_si256(_mm256_cmpeq_epi16(_mm256_and_si256(v, k.bgOpaque), k.bgOpaque), bgEn);
+    __m256i spOp = _mm256_and_si256(_mm256_cmpeq_epi16(_mm256_and_si256(v, k.spOpaque), k.spOpaque), spEn);
+    __m256i s0 = _mm256_cmpeq_epi16(_mm256_and_si256(v, k.sprite0), k.sprite0);
+    hit = _mm256_or_si256(hit, _mm256_and_si256(s0, _mm256_and_si256(bgOp, spOp)));
+    __m256i behind = _mm256_cmpeq_epi16(_mm256_and_si256(v, k.behind), k.behind);
+    __m256i useSp = _mm256_andnot_si256(_mm256_and_si256(behind, bgOp), spOp);
+    __m256i bgCol = _mm256_blendv_epi8(k.universal, _mm256_and_si256(v, k.bgColor), bgEn);
+    __m256i spCol = _mm256_and_si256(_mm256_srli_epi16(v, LinePixel::kSpColorShift), k.bgColor);
+    return _mm256_blendv_epi8(bgCol, spCol, useSp);
+}
+
+template <bool kOut>
+NES_TARGET_AVX2 bool composeAVX2(const uint16_t* line, const LineState& st, uint8_t* out) {
+    MuxConstsAVX k;
+    k.bgColor = _mm256_set1_epi16(LinePixel::kBgColor);
+    k.bgOpaque = _mm256_set1_epi16(LinePixel::kBgOpaque);
+    k.sprite0 = _mm256_set1_epi16(LinePixel::kSprite0);
+    k.spOpaque = _mm256_set1_epi16(LinePixel::kSpOpaque);
+    k.behind = _mm256_set1_epi16((int16_t)LinePixel::kSpBehind);
+    k.universal = _mm256_set1_epi16(st.universal);
+    const __m128i bg = _mm_set1_epi16(st.showBG ? -1 : 0), sp = _mm_set1_epi16(st.showSP ? -1 : 0);
+    const __m256i bgEn = _mm256_broadcastsi128_si256(bg), spEn = _mm256_broadcastsi128_si256(sp);
+    // First vector: pixels 0-7 take the left-8 masks, 8-15 the plain enables
+    const __m256i bgEnFirst = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(st.bgLeft8 ? bg : _mm_setzero_si128()), bg, 1);
+    const __m256i spEnFirst = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(st.spLeft8 ? sp : _mm_setzero_si128()), sp, 1);
+
+    __m256i hit = _mm256_setzero_si256();
+    for (int x = 0; x < kWidth; x += 32) {
+        const __m256i* in = reinterpret_cast<const __m256i*>(line + x);
+        __m256i a = muxAVX2(_mm256_loadu_si256(in), x ? bgEn : bgEnFirst, x ? spEn : spEnFirst, k, hit);
+        __m256i b = muxAVX2(_mm256_loadu_si256(in + 1), bgEn, spEn, k, hit);
+        if (kOut) {
+            // PACKUS interleaves the lanes of a and b; put the 32 indices back in pixel order
+            __m256i idx = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), idx);
+        }
+    }
+    return !_mm256_testz_si256(hit, hit);
+}
+#endif
+
+}  // namespace
+
+Compositor::Isa Compositor::bestIsa() {
+    const CpuFeatures& f = cpuFeatures();
+    if (f.avx2) return Isa::AVX2;
+    if (f.sse41) return Isa::SSE41;
+    return Isa::Scalar;
+}
+
+const char* Compositor::isaName(Isa isa) {
+    switch (isa) {
+        case Isa::AVX2:
+            return "AVX2";
+        case Isa::SSE41:
+            return "SSE4.1";
+        default:
+            return "scalar";
+    }
+}
+
+void Compositor::forceIsa(Isa isa) {
+    const CpuFeatures& f = cpuFeatures();
+    if (isa == Isa::AVX2 && !f.avx2) isa = Isa::SSE41;
+    if (isa == Isa::SSE41 && !f.sse41) isa = Isa::Scalar;
+    active = isa;
+    composeFn = &composeScalar<true>;
+    hitFn = &composeScalar<false>;
+#ifdef NES_X86
+    if (isa == Isa::SSE41) {
+        composeFn = &composeSSE41<true>;
+        hitFn = &composeSSE41<false>;
+    }
+    if (isa == Isa::AVX2) {
+        composeFn = &composeAVX2<true>;
+        hitFn = &composeAVX2<false>;
+    }
+#endif
+}
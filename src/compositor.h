@@ -0,0 +1,51 @@
+// compositor.h
+#pragma once
+#include <cstdint>
+
+// Packed per-pixel staging for one scanline: the BG pipeline writes the low
+// byte (and clears the rest) at dots 1-256, sprite rendering ORs in the high
+// byte at dot 257.
+struct LinePixel {
+    static constexpr uint16_t kBgColor = 0x003F;   // BG color index (universal when transparent)
+    static constexpr uint16_t kBgOpaque = 0x0040;  // raw BG pixel != 0, after the BG left-8 mask
+    static constexpr uint16_t kSprite0 = 0x0080;   // drawn by the first sprite of secondary OAM
+    static constexpr int kSpColorShift = 8;
+    static constexpr uint16_t kSpColor = 0x3F00;   // sprite color index
+    static constexpr uint16_t kSpOpaque = 0x4000;  // raw sprite pixel != 0
+    static constexpr uint16_t kSpBehind = 0x8000;  // sprite priority: behind the background
+};
+
+// Scanline compositor: resolves BG/sprite priority, the left-8 masks and
+// sprite-0 hit from a packed line into 6-bit color indices, 16 (SSE4.1) or
+// 32 (AVX2) pixels per step, with a scalar fallback. All paths produce
+// identical output.
+struct Compositor {
+    static constexpr int kWidth = 256;
+    enum class Isa { Scalar, SSE41, AVX2 };
+
+    // PPUMASK and the universal background color as of the end of the line
+    struct LineState {
+        uint8_t universal = 0;
+        bool showBG = false, showSP = false;
+        bool bgLeft8 = false, spLeft8 = false;
+    };
+
+    static Isa bestIsa();
+    static const char* isaName(Isa isa);
+
+    Compositor() { forceIsa(bestIsa()); }
+    void forceIsa(Isa isa);  // benchmarking; clamped to what the CPU has
+    Isa isa() const { return active; }
+
+    // Writes kWidth color indices to `out`; true if sprite 0 hit on this line
+    bool compose(const uint16_t* line, const LineState& st, uint8_t* out) const { return composeFn(line, st, out); }
+    // Sprite-0 hit only, for skipped frames
+    bool spriteZeroHit(const uint16_t* line, const LineState& st) const { return hitFn(line, st, nullptr); }
+
+   private:
+    using Fn = bool (*)(const uint16_t* line, const LineState& st, uint8_t* out);
+
+    Isa active = Isa::Scalar;
+    Fn composeFn = nullptr;
+    Fn hitFn = nullptr;
+};
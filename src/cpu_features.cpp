@@ -0,0 +1,39 @@
+// cpu_features.cpp
+#include "cpu_features.h"
+
+#if defined(NES_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static CpuFeatures detect() {
+    CpuFeatures f;
+#if defined(NES_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    f.sse2 = __builtin_cpu_supports("sse2");
+    f.sse41 = __builtin_cpu_supports("sse4.1");
+    f.avx2 = __builtin_cpu_supports("avx2");
+    f.pclmul = f.sse41 && __builtin_cpu_supports("pclmul");
+    f.sha = f.sse41 && __builtin_cpu_supports("sha");
+#elif defined(NES_X86) && defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    int maxLeaf = r[0];
+    __cpuid(r, 1);
+    f.sse2 = (r[3] & (1 << 26)) != 0;
+    f.sse41 = (r[2] & (1 << 19)) != 0;
+    f.pclmul = f.sse41 && (r[2] & (1 << 1)) != 0;
+    bool osxsave = (r[2] & (1 << 27)) != 0;
+    bool ymmSaved = osxsave && ((_xgetbv(0) & 0x6) == 0x6);  // OS preserves YMM state
+    if (maxLeaf >= 7) {
+        __cpuidex(r, 7, 0);
+        f.avx2 = ymmSaved && (r[1] & (1 << 5)) != 0;
+        f.sha = f.sse41 && (r[1] & (1 << 29)) != 0;
+    }
+#endif
+    return f;
+}
+
+const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures f = detect();
+    return f;
+}
@@ -0,0 +1,33 @@
+// cpu_features.h
+#pragma once
+
+// Runtime ISA detection for the vectorized paths. Kernels are compiled with
+// per-function target attributes (NES_TARGET_*) so the rest of the build keeps
+// its baseline flags, and are picked once at init from cpuFeatures().
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define NES_X86 1
+#endif
+
+#if defined(NES_X86) && (defined(__GNUC__) || defined(__clang__))
+#define NES_TARGET_SSE2 __attribute__((target("sse2")))
+#define NES_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define NES_TARGET_AVX2 __attribute__((target("avx2")))
+#define NES_TARGET_CLMUL __attribute__((target("sse4.1,pclmul")))
+#define NES_TARGET_SHA __attribute__((target("sse4.1,sha")))
+#else
+#define NES_TARGET_SSE2
+#define NES_TARGET_SSE41
+#define NES_TARGET_AVX2
+#define NES_TARGET_CLMUL
+#define NES_TARGET_SHA
+#endif
+
+struct CpuFeatures {
+    bool sse2 = false;
+    bool sse41 = false;
+    bool avx2 = false;
+    bool pclmul = false;  // with sse41
+    bool sha = false;     // with sse41
+};
+
+const CpuFeatures& cpuFeatures();
@@ -0,0 +1,162 @@
+// emu_thread.cpp
+#include "emu_thread.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "apu.h"
+#include "cartridge.h"
+
+void EmuThread::start() {
+    if (thr.joinable()) return;
+    quit = false;
+    thr = std::thread([this] { run(); });
+}
+
+void EmuThread::stop() {
+    if (!thr.joinable()) return;
+    EmuCommand c;
+    c.type = EmuCommand::Quit;
+    post(std::move(c));
+    thr.join();
+    video.stop();
+}
+
+void EmuThread::post(EmuCommand c) {
+    {
+        std::lock_guard<std::mutex> lk(qMutex);
+        queue.push_back(std::move(c));
+    }
+    qCv.notify_one();
+}
+
+bool EmuThread::boot(const std::string& path) {
+    try {
+        if (path.empty()) return false;
+        // Flush the outgoing game's battery RAM and audio device before replacing it
+        if (nes.cart) nes.cart->saveSave();
+        nes.stopAudio();
+        if (!nes.loadROM(path)) throw std::runtime_error("loadROM failed");
+        nes.threadedAudio = threadedAudio;
+        nes.powerOn();
+        nes.input->source = &pad;
+        nes.ppu->spriteEval = (PPU::SpriteEval)spriteEval.load();
+        nes.apu->setSpeed(pacer.turbo ? pacer.turboPresentEvery : 1);
+        nes.apu->setQuality((Resampler::Quality)audioQuality.load());
+        pacer.reset();
+        romPath = path;
+        return true;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return false;
+    }
+}
+
+void EmuThread::execute(const EmuCommand& c) {
+    switch (c.type) {
+        case EmuCommand::LoadROM:
+            hasGame = boot(c.path);
+            paused = false;
+            break;
+        case EmuCommand::Reset:
+            // power cycle is simplest & safest
+            if (hasGame) hasGame = boot(romPath);
+            break;
+        case EmuCommand::Pause:
+            paused = true;
+            break;
+        case EmuCommand::Resume:
+            paused = false;
+            pacer.reset();
+            break;
+        case EmuCommand::SetTurbo:
+            pacer.turbo = (c.value != 0);
+            turbo = pacer.turbo;
+            if (nes.apu) nes.apu->setSpeed(pacer.turbo ? pacer.turboPresentEvery : 1);
+            pacer.reset();
+            break;
+        case EmuCommand::SetTurboFactor:
+            pacer.turboPresentEvery = (c.value > 0) ? c.value : 1;
+            turboFactor = pacer.turboPresentEvery;
+            if (pacer.turbo && nes.apu) nes.apu->setSpeed(pacer.turboPresentEvery);
+            break;
+        case EmuCommand::SetAdaptiveSkip:
+            pacer.adaptiveSkip = (c.value != 0);
+            adaptiveSkip = pacer.adaptiveSkip;
+            pacer.reset();
+            break;
+        case EmuCommand::SetAudioQuality:
+            audioQuality = c.value;
+            if (nes.apu) nes.apu->setQuality((Resampler::Quality)c.value);
+            break;
+        case EmuCommand::SetThreadedAudio:
+            threadedAudio = (c.value != 0);  // takes effect on the next power cycle
+            break;
+        case EmuCommand::SetSpriteEval:
+            spriteEval = c.value;
+            if (nes.ppu) nes.ppu->spriteEval = (PPU::SpriteEval)c.value;
+            break;
+        case EmuCommand::Quit:
+            quit = true;
+            break;
+    }
+}
+
+void EmuThread::run() {
+    using clock = std::chrono::steady_clock;
+    const auto framePeriod = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(FramePacer::kNtscFrameSec));
+
+    auto prev = clock::now();
+    while (!quit) {
+        bool idled = false;
+        {
+            std::unique_lock<std::mutex> lk(qMutex);
+            // Nothing to emulate: sleep until the UI asks for something
+            if (queue.empty() && (!hasGame || paused)) {
+                qCv.wait(lk, [&] { return !queue.empty(); });
+                idled = true;
+            }
+            while (!queue.empty()) {
+                EmuCommand c = std::move(queue.front());
+                queue.pop_front();
+                lk.unlock();
+                execute(c);
+                lk.lock();
+            }
+        }
+        if (quit || !hasGame || paused) continue;
+
+        auto now = clock::now();
+        double dt = idled ? FramePacer::kNtscFrameSec : std::chrono::duration<double>(now - prev).count();
+        prev = now;
+
+        FramePacer::Plan plan = pacer.plan(dt);
+        for (int i = 0; i < plan.frames; ++i) {
+            nes.runFrame(/*compose=*/i >= plan.composeFrom);
+        }
+        if (plan.frames > 0) {
+            frameNo += (uint64_t)plan.frames;
+            video.submit(nes.ppu->frameIndex, nes.ppu->lineEmphasis, frameNo);
+        }
+
+        // Stats for the performance overlay
+        double inst = (dt > 0.0) ? plan.frames / dt : 0.0;
+        emuFps = emuFps.load(std::memory_order_relaxed) * 0.9 + inst * 0.1;
+        loopMs = pacer.hostFrameSec * 1000.0;
+        lastRun = plan.frames;
+        lastSkipped = plan.composeFrom;
+        totalSkipped = pacer.totalSkipped;
+        APU* out = nes.audioOutput();
+        audioUnderruns = out->underruns.load(std::memory_order_relaxed);
+        audioOverruns = out->overruns.load(std::memory_order_relaxed);
+        audioLatencyMs = out->latencyMs();
+        audioRateAdjust = out->rateAdjust.load(std::memory_order_relaxed);
+
+        // Realtime: wake once per NES frame; oversleep shows up in the next dt
+        // and is paid back by the pacer. Turbo: no sleeping at all.
+        if (!pacer.turbo) std::this_thread::sleep_until(now + framePeriod);
+    }
+}
@@ -0,0 +1,75 @@
+// emu_thread.h
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "frame_pacer.h"
+#include "input.h"
+#include "nes.h"
+#include "ppu.h"
+#include "resampler.h"
+#include "video_worker.h"
+
+// Requests from the UI thread; executed between frames on the emulation thread
+struct EmuCommand {
+    enum Type {
+        LoadROM, Reset, Pause, Resume, SetTurbo, SetTurboFactor, SetAdaptiveSkip,
+        SetAudioQuality, SetThreadedAudio, SetSpriteEval, Quit
+    };
+    Type type = Pause;
+    std::string path;  // LoadROM
+    int value = 0;     // SetTurbo/SetTurboFactor/SetAdaptiveSkip/SetAudioQuality/SetThreadedAudio/SetSpriteEval
+};
+
+// Runs the NES core on its own thread, paced by FramePacer against the wall clock.
+// The UI thread talks to it only through the command queue, the published pad
+// state and the video worker, so a slow present never stalls audio.
+struct EmuThread {
+    // UI -> emu
+    PadState pad;
+    void post(EmuCommand c);
+
+    // emu -> UI; started by the UI thread (it knows the texture format)
+    VideoWorker video;
+    std::atomic<bool> hasGame{false};
+    std::atomic<bool> paused{false};
+    std::atomic<bool> turbo{false};
+    std::atomic<bool> adaptiveSkip{true};
+    std::atomic<int> turboFactor{4};
+    std::atomic<int> audioQuality{(int)Resampler::Quality::Medium};
+    // Synthesize on an AudioWorker thread; default on when there is a core to spare
+    std::atomic<bool> threadedAudio{std::thread::hardware_concurrency() >= 3};
+    std::atomic<int> spriteEval{(int)PPU::SpriteEval::Binned};
+    std::atomic<double> emuFps{0.0};
+    std::atomic<double> loopMs{0.0};  // EMA of emulation loop time
+    std::atomic<int> lastRun{0}, lastSkipped{0};
+    std::atomic<uint64_t> totalSkipped{0};
+    std::atomic<uint64_t> audioUnderruns{0}, audioOverruns{0};
+    std::atomic<double> audioLatencyMs{0.0};
+    std::atomic<double> audioRateAdjust{0.0};  // dynamic rate control nudge (fraction)
+
+    void start();
+    void stop();  // joins; safe to call twice
+    ~EmuThread() { stop(); }
+
+   private:
+    void run();
+    void execute(const EmuCommand& c);
+    bool boot(const std::string& path);
+
+    NES nes;
+    FramePacer pacer;
+    std::string romPath;
+    uint64_t frameNo = 0;
+    bool quit = false;
+
+    std::thread thr;
+    std::mutex qMutex;
+    std::condition_variable qCv;
+    std::deque<EmuCommand> queue;
+};
@@ -0,0 +1,54 @@
+// frame_pacer.cpp
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <cmath>
+
+void FramePacer::reset() {
+    hostFrameSec = kNtscFrameSec;
+    debtSec = kSlackSec;
+    lastRun = lastSkipped = 0;
+}
+
+FramePacer::Plan FramePacer::plan(double hostDtSec) {
+    Plan p;
+
+    // Ignore absurd gaps (window drag, breakpoint, ROM load) instead of fast-forwarding through them
+    hostDtSec = std::clamp(hostDtSec, 0.0, 0.25);
+    hostFrameSec = hostFrameSec * 0.9 + hostDtSec * 0.1;
+
+    if (turbo) {
+        // Uncapped: the caller disables vsync; only the last frame of each batch is shown
+        debtSec = kSlackSec;
+        p.frames = std::max(1, turboPresentEvery);
+        p.composeFrom = p.frames - 1;
+    } else if (!adaptiveSkip) {
+        debtSec = kSlackSec;
+        p.frames = 1;
+        p.composeFrom = 0;
+    } else {
+        debtSec += hostDtSec;
+        int owed = (int)(debtSec / kNtscFrameSec);
+
+        // Budget: NES frames that fit in a typical host frame, plus one to catch
+        // up on spikes. Anything beyond that is dropped rather than spiralling
+        // (audio resyncs on its own).
+        int budget = (int)std::ceil(hostFrameSec / kNtscFrameSec) + 1;
+        budget = std::clamp(budget, 1, maxSkip + 1);
+        if (owed > budget) {
+            owed = budget;
+            debtSec = owed * kNtscFrameSec + kSlackSec;
+        }
+        debtSec -= owed * kNtscFrameSec;
+
+        // Host frame budget smaller than an NES frame (e.g. 120/144 Hz): some
+        // iterations legitimately run zero frames and just re-present.
+        p.frames = owed;
+        p.composeFrom = std::max(0, owed - 1);
+    }
+
+    lastRun = p.frames;
+    lastSkipped = p.composeFrom;
+    totalSkipped += (uint64_t)p.composeFrom;
+    return p;
+}
@@ -0,0 +1,37 @@
+// frame_pacer.h
+#pragma once
+#include <cstdint>
+
+// Decides how many NES frames to emulate per host loop iteration and which of
+// them actually need a composed picture (turbo + adaptive frameskip).
+struct FramePacer {
+    static constexpr double kNtscFrameSec = 1.0 / 60.0988;  // 2C02 NTSC field rate
+
+    // Turbo: run uncapped, compose/present only every Nth frame
+    bool turbo = false;
+    int turboPresentEvery = 4;
+
+    // Adaptive frameskip: follow the host clock, skip composition of frames
+    // that would never reach the screen. Off = one frame per present (vsync-paced).
+    bool adaptiveSkip = true;
+    int maxSkip = 4;  // never run more than maxSkip hidden frames in a row
+
+    // Moving host frame-time budget (EMA of loop time)
+    double hostFrameSec = kNtscFrameSec;
+    // Half a frame of slack keeps host jitter from alternating 0/2 frames per present
+    static constexpr double kSlackSec = kNtscFrameSec * 0.5;
+    double debtSec = kSlackSec;  // emulated time owed to the host clock
+
+    // Stats (performance overlay)
+    int lastRun = 0;
+    int lastSkipped = 0;
+    uint64_t totalSkipped = 0;
+
+    struct Plan {
+        int frames = 1;       // frames to emulate this iteration
+        int composeFrom = 0;  // frames [0, composeFrom) run without composition
+    };
+
+    Plan plan(double hostDtSec);
+    void reset();
+};
@@ -1,7 +1,7 @@
 // input.cpp
 #include "input.h"
 
-void Input::poll(){
+uint8_t readHostPad(SDL_GameController* controller){
     // Keyboard
     const uint8_t* k = SDL_GetKeyboardState(nullptr);
     uint8_t bits=0;
@@ -26,6 +26,10 @@ void Input::poll(){
         bits |= SDL_GameControllerGetButton(controller, SDL_CONTROLLER_BUTTON_DPAD_RIGHT) ? (1<<7) : 0;
     }
 
-    padState = bits;
+    return bits;
+}
+
+void Input::poll(){
+    padState = source ? source->buttons() : readHostPad(controller);
     if(strobe) shift1 = padState;
 }
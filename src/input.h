@@ -1,8 +1,25 @@
 // input.h
 #pragma once
+#include <atomic>
 #include <cstdint>
 #include <SDL2/SDL.h>
 
+// Pad bits published by the UI thread and latched by the emulation thread.
+// Buttons and the publish timestamp share one atomic word so a reader never
+// sees a torn pair.
+struct PadState {
+    std::atomic<uint64_t> word{0};  // bits 0..7 = buttons, bits 8..63 = timestamp (us)
+
+    void publish(uint8_t bits, uint64_t timestampUs) {
+        word.store((timestampUs << 8) | bits, std::memory_order_release);
+    }
+    uint8_t buttons() const { return (uint8_t)(word.load(std::memory_order_acquire) & 0xFF); }
+    uint64_t timestampUs() const { return word.load(std::memory_order_acquire) >> 8; }
+};
+
+// Sample keyboard + optional controller into NES pad bits (call on the SDL event thread)
+uint8_t readHostPad(SDL_GameController* controller);
+
 struct Input {
     // NES pad latch/shift registers (controller 1 only here)
     uint8_t shift1 = 0;
@@ -11,9 +28,12 @@ struct Input {
     // Aggregated state for this frame (A,B,Select,Start,Up,Down,Left,Right) active-high in bits 0..7
     uint8_t padState = 0;
 
-    // Optional SDL game controller
+    // Optional SDL game controller (single-threaded use only)
     SDL_GameController* controller = nullptr;
 
+    // If set, poll() latches the published pad instead of touching SDL
+    const PadState* source = nullptr;
+
     void setStrobe(uint8_t v){ strobe = v & 1; if(strobe) shift1 = padState; }
     uint8_t read4016(){ // typical serial read
         uint8_t bit = (shift1 & 1);
@@ -21,6 +41,6 @@ struct Input {
         return bit | 0x40; // upper bits open bus-ish; ensure bit6 set per many emus
     }
 
-    // Called once per frame to gather inputs (keyboard + controller)
+    // Called once per frame to gather inputs (published pad, or keyboard + controller)
     void poll();
 };
@@ -4,14 +4,24 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <filesystem>
-#include <stdexcept>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "audio_render.h"
+#include "bench.h"
+#include "emu_thread.h"
 #include "input.h"
-#include "nes.h"
+#include "ntsc_filter.h"
+#include "palette.h"
 #include "ppu.h"
+#include "rom_db.h"
+#include "rom_library.h"
+#include "rom_thumbnails.h"
+#include "scaler.h"
 #include "timgui.h"
 
 namespace fs = std::filesystem;
@@ -20,12 +30,108 @@ namespace fs = std::filesystem;
 // Helpers
 // --------------------------------------------------------------------------------------
 
-static void uploadNESFrame(SDL_Texture* tex, const uint32_t* fb) {
-    // Upload 256x240 RGBA8888 into the texture (no present here; caller decides order)
-    SDL_UpdateTexture(tex, nullptr, fb, 256 * sizeof(uint32_t));
+// The renderer's preferred 32-bit RGB texture format, so uploads need no
+// conversion inside SDL or the driver; ARGB8888 if it lists none
+static Uint32 nativeTextureFormat(SDL_Renderer* ren) {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(ren, &info) == 0) {
+        for (Uint32 i = 0; i < info.num_texture_formats; ++i) {
+            Uint32 f = info.texture_formats[i];
+            if (SDL_ISPIXELFORMAT_PACKED(f) && SDL_PIXELLAYOUT(f) == SDL_PACKEDLAYOUT_8888) return f;
+        }
+    }
+    return SDL_PIXELFORMAT_ARGB8888;
+}
+
+static Palette::Layout paletteLayout(Uint32 format) {
+    int bpp;
+    Uint32 rm, gm, bm, am;
+    Palette::Layout l;
+    if (!SDL_PixelFormatEnumToMasks(format, &bpp, &rm, &gm, &bm, &am) || !rm || !gm || !bm) return l;
+    auto shift = [](Uint32 mask) {
+        uint8_t s = 0;
+        while (!(mask & 1)) mask >>= 1, ++s;
+        return s;
+    };
+    l.r = shift(rm);
+    l.g = shift(gm);
+    l.b = shift(bm);
+    l.a = (uint8_t)(48 - l.r - l.g - l.b);  // the remaining byte, alpha or padding
+    return l;
 }
 
-static SDL_Rect letterboxDest(SDL_Window* win, int baseW, int baseH, bool integerScale) {
+static void uploadNESFrame(SDL_Texture* tex, const VideoFrame& f, const Palette& palette) {
+    // Unfiltered frames are expanded straight into the texture memory; filtered
+    // ones are copied row by row, honoring its pitch (no present here; caller decides order)
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(tex, nullptr, &pixels, &pitch) != 0) return;
+    const size_t rowBytes = (size_t)f.width * sizeof(uint32_t);
+    if (f.indexed) {
+        palette.expandFrame(f.indices.data(), f.emphasis, pixels, pitch);
+    } else if ((size_t)pitch == rowBytes) {
+        std::memcpy(pixels, f.pixels.data(), rowBytes * f.height);
+    } else {
+        for (int y = 0; y < f.height; ++y)
+            std::memcpy(static_cast<uint8_t*>(pixels) + (size_t)y * pitch, &f.pixels[(size_t)y * f.width], rowBytes);
+    }
+    SDL_UnlockTexture(tex);
+}
+
+// Video filters run on the video worker (see VideoWorker::Filter)
+enum VideoFilterKind { FilterNone = 0, FilterNtsc = 1, FilterScale2x = 2, FilterScale3x = 3, FilterXbrLite = 4 };
+
+static const char* videoFilterName(int kind) {
+    switch (kind) {
+        case FilterNtsc:
+            return "NTSC";
+        case FilterScale2x:
+            return Scaler::name(Scaler::Kind::Scale2x);
+        case FilterScale3x:
+            return Scaler::name(Scaler::Kind::Scale3x);
+        case FilterXbrLite:
+            return Scaler::name(Scaler::Kind::XbrLite);
+        default:
+            return "none";
+    }
+}
+
+static void setVideoFilter(VideoWorker& video, int kind, Palette::Layout layout) {
+    if (kind == FilterNtsc) {
+        auto ntsc = std::make_shared<NtscFilter>(layout);
+        ThreadPool* pool = &video.pool;
+        video.setFilter(
+            [ntsc, pool](const EmuFrame& src, const VideoFrame&, VideoFrame& out) {
+                out.width = NtscFilter::kOutWidth;
+                out.height = PPU::HEIGHT;
+                out.pixels.resize((size_t)out.width * out.height);
+                ntsc->renderFrame(src.indices, src.emphasis, src.frameNo, out.pixels.data(),
+                                  out.width * (int)sizeof(uint32_t), pool);
+            },
+            /*needsRgb=*/false);
+        return;
+    }
+    if (kind == FilterScale2x || kind == FilterScale3x || kind == FilterXbrLite) {
+        const Scaler::Kind sk = kind == FilterScale2x   ? Scaler::Kind::Scale2x
+                                : kind == FilterScale3x ? Scaler::Kind::Scale3x
+                                                        : Scaler::Kind::XbrLite;
+        auto scaler = std::make_shared<Scaler>(sk);
+        ThreadPool* pool = &video.pool;
+        video.setFilter([scaler, pool](const EmuFrame&, const VideoFrame& rgb, VideoFrame& out) {
+            const int n = scaler->factor();
+            out.width = rgb.width * n;
+            out.height = rgb.height * n;
+            out.pixels.resize((size_t)out.width * out.height);
+            scaler->scale(rgb.pixels.data(), out.pixels.data(), out.width * (int)sizeof(uint32_t), pool);
+        });
+        return;
+    }
+    video.setFilter(nullptr);
+}
+
+// `texScale`: texture rows per NES row (a scaler's factor), so integer scaling
+// steps in whole window pixels per texture pixel rather than per NES pixel
+static SDL_Rect letterboxDest(SDL_Window* win, int baseW, int baseH, int texScale, bool integerScale) {
     int ww, wh;
     SDL_GetWindowSize(win, &ww, &wh);
 
@@ -33,7 +139,11 @@ static SDL_Rect letterboxDest(SDL_Window* win, int baseW, int baseH, bool intege
     float sy = (float)wh / (float)baseH;
     float s = std::min(sx, sy);
 
-    if (integerScale) s = std::max(1.0f, std::floor(s));
+    if (integerScale) {
+        // A texture too large to fit once falls back to whole steps per NES pixel
+        const float t = std::floor(s / (float)texScale);
+        s = t >= 1.0f ? t * (float)texScale : std::max(1.0f, std::floor(s));
+    }
 
     int w = (int)std::round(baseW * s);
     int h = (int)std::round(baseH * s);
@@ -50,20 +160,16 @@ static void setScaleQuality(bool linear) {
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, linear ? "1" : "0");
 }
 
-static std::vector<std::string> listNES(const std::string& folder) {
-    std::vector<std::string> out;
-    std::error_code ec;
-    if (!fs::exists(folder, ec) || !fs::is_directory(folder, ec)) return out;
-    for (auto& e : fs::directory_iterator(folder, ec)) {
-        if (e.is_regular_file()) {
-            auto p = e.path();
-            auto ext = p.extension().string();
-            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-            if (ext == ".nes") out.push_back(p.string());
-        }
+// Where the ROM library index and thumbnails live: the user's settings
+// folder, or the working directory if SDL can't provide a writable one.
+// Ends in a separator unless empty.
+static std::string userDataDir() {
+    std::string dir;
+    if (char* pref = SDL_GetPrefPath("nes-emu", "nes")) {
+        dir = pref;
+        SDL_free(pref);
     }
-    std::sort(out.begin(), out.end());
-    return out;
+    return dir;
 }
 
 static std::string baseName(const std::string& path) {
@@ -86,6 +192,17 @@ static std::string defaultFontPath() {
 // --------------------------------------------------------------------------------------
 
 int main(int argc, char** argv) {
+    // Command-line tools that don't need a window
+    if (argc >= 2 && std::strcmp(argv[1], "--bench") == 0) {
+        return runBenchmark(argc >= 3 ? argv[2] : nullptr);
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--render-wav") == 0) {
+        return runAudioRender(argc, argv);
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--build-romdb") == 0) {
+        return runRomDbBuild(argc, argv);
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER | SDL_INIT_TIMER) != 0) {
         std::fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
         return 1;
@@ -122,10 +239,12 @@ int main(int argc, char** argv) {
     // We’ll handle scaling manually; no logical size (so GUI is crisp at native pixels).
     // SDL_RenderSetLogicalSize(ren, baseW, baseH); // <- leave disabled
 
-    // NES texture (ARGB8888 matches your framebuffer)
+    // NES texture, in the renderer's native format; the video worker produces that layout.
+    // Recreated when a filter changes the output size.
     setScaleQuality(false);  // nearest by default
-    SDL_Texture* tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888,
-                                         SDL_TEXTUREACCESS_STREAMING, baseW, baseH);
+    const Uint32 texFormat = nativeTextureFormat(ren);
+    int texW = baseW, texH = baseH;
+    SDL_Texture* tex = SDL_CreateTexture(ren, texFormat, SDL_TEXTUREACCESS_STREAMING, texW, texH);
     if (!tex) {
         std::fprintf(stderr, "SDL_CreateTexture: %s\n", SDL_GetError());
         SDL_DestroyRenderer(ren);
@@ -134,30 +253,36 @@ int main(int argc, char** argv) {
         return 4;
     }
 
-    // ------------------ NES core ------------------
-    NES nes;
-    auto loadAndBoot = [&](const std::string& romPath) -> bool {
-        try {
-            if (romPath.empty()) return false;
-            if (!nes.loadROM(romPath)) throw std::runtime_error("loadROM failed");
-            nes.powerOn();
-            return true;
-        } catch (const std::exception& e) {
-            std::fprintf(stderr, "Error: %s\n", e.what());
-            return false;
-        }
+    // ------------------ NES core (emulation thread) ------------------
+    // Heap-allocated: holds three full frames for the triple buffer
+    auto emu = std::make_unique<EmuThread>();
+    emu->video.start(paletteLayout(texFormat));
+    emu->start();
+
+    auto post = [&](EmuCommand::Type type, int value = 0, const std::string& path = std::string()) {
+        EmuCommand c;
+        c.type = type;
+        c.value = value;
+        c.path = path;
+        emu->post(std::move(c));
+    };
+    // ROM loads and resets are asynchronous; hasGame follows the emulation thread
+    auto loadAndBoot = [&](const std::string& romPath) {
+        if (!romPath.empty()) post(EmuCommand::LoadROM, 0, romPath);
     };
 
-    bool hasGame = false;
-    if (!initialRomPath.empty()) hasGame = loadAndBoot(initialRomPath);
+    if (!initialRomPath.empty()) loadAndBoot(initialRomPath);
 
-    // Open first available controller (optional)
+    // Turbo: the emulation thread runs uncapped and composes every Nth frame;
+    // this thread keeps presenting the newest frame at vsync.
+    auto setTurbo = [&](bool on) { post(EmuCommand::SetTurbo, on ? 1 : 0); };
+
+    // Open first available controller (optional). Owned by this thread; the
+    // emulation thread only sees the published pad bits.
+    SDL_GameController* controller = nullptr;
     for (int i = 0; i < SDL_NumJoysticks(); ++i) {
         if (SDL_IsGameController(i)) {
-            // Note: NES::powerOn creates Input; we open handle into nes.input
-            if (nes.input) {
-                nes.input->controller = SDL_GameControllerOpen(i);
-            }
+            controller = SDL_GameControllerOpen(i);
             break;
         }
     }
@@ -169,21 +294,68 @@ int main(int argc, char** argv) {
 
     // UI state
     bool showUI = true;
-    bool paused = false;
     bool integerScale = true;
     int scaleFilter = 0;  // 0=nearest, 1=linear
+    int videoFilter = FilterNone;
+    bool showPerf = false;
 
     std::string romFolder = initialRomPath.empty() ? fs::current_path().string()
-                                                   : fs::path(initialRomPath).parent_path().string();
-    auto romList = listNES(romFolder);
+                                                   : fs::absolute(initialRomPath).parent_path().string();
+    // Scanned in the background; the browser picks up each published listing
+    const std::string dataDir = userDataDir();
+    RomLibrary library(dataDir + "romlibrary.idx");
+    std::vector<RomEntry> romList;
+    std::vector<std::string> shortNames;
+    uint64_t romListVersion = 0;
     int selectedRom = 0;
-    if (!romList.empty()) {
-        // try to pick the passed one if present
-        if (!initialRomPath.empty()) {
-            auto it = std::find(romList.begin(), romList.end(), fs::absolute(initialRomPath).string());
-            if (it != romList.end()) selectedRom = int(it - romList.begin());
+    // Selected once it shows up (the passed one, if any), then kept by path
+    std::string selectPath =
+        initialRomPath.empty() ? std::string() : fs::absolute(initialRomPath).lexically_normal().string();
+    auto scanFolder = [&](const std::string& folder) {
+        romFolder = folder;
+        library.scan(romFolder);
+    };
+    scanFolder(romFolder);
+
+    // Previews: textures for the rows the browser has drawn lately, oldest
+    // dropped past the budget (never one drawn this frame). nullptr: the ROM
+    // has none.
+    RomThumbnails thumbs(dataDir + "thumbs");
+    struct ThumbTexture {
+        SDL_Texture* tex = nullptr;
+        uint64_t usedFrame = 0;
+    };
+    constexpr size_t kMaxThumbTextures = 256;
+    std::unordered_map<std::string, ThumbTexture> thumbTextures;  // by path
+    bool showPreviews = true;
+    uint64_t uiFrame = 0;
+    auto thumbTexture = [&](const RomEntry& rom) -> SDL_Texture* {
+        auto it = thumbTextures.find(rom.path);
+        if (it != thumbTextures.end()) {
+            it->second.usedFrame = uiFrame;
+            return it->second.tex;
         }
-    }
+        std::vector<uint32_t> pixels;
+        const RomThumbnails::Status status = thumbs.fetch(rom, pixels);
+        if (status == RomThumbnails::Status::Pending) return nullptr;
+        SDL_Texture* tex = nullptr;
+        if (status == RomThumbnails::Status::Ready) {
+            tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, RomThumbnails::kWidth,
+                                    RomThumbnails::kHeight);
+            if (tex) SDL_UpdateTexture(tex, nullptr, pixels.data(), RomThumbnails::kWidth * 4);
+        }
+        if (thumbTextures.size() >= kMaxThumbTextures) {
+            auto oldest = std::min_element(thumbTextures.begin(), thumbTextures.end(), [](auto& a, auto& b) {
+                return a.second.usedFrame < b.second.usedFrame;
+            });
+            if (oldest->second.usedFrame < uiFrame) {
+                if (oldest->second.tex) SDL_DestroyTexture(oldest->second.tex);
+                thumbTextures.erase(oldest);
+            }
+        }
+        thumbTextures[rom.path] = {tex, uiFrame};
+        return tex;
+    };
 
     // FPS counter (simple)
     Uint64 ticksPrev = SDL_GetPerformanceCounter();
@@ -191,6 +363,16 @@ int main(int argc, char** argv) {
     bool browserOpen = true;
     bool running = true;
     while (running) {
+        // Snapshot emulation state for this UI frame
+        bool hasGame = emu->hasGame;
+        bool paused = emu->paused;
+        thumbs.setGameRunning(hasGame && !paused, videoFilter != FilterNone ? emu->video.pool.threads() - 1 : 0);
+        ++uiFrame;
+        auto togglePause = [&]() {
+            post(paused ? EmuCommand::Resume : EmuCommand::Pause);
+            paused = !paused;
+        };
+
         // ------------------ Begin UI frame ------------------
         timgui::NewFrame();
 
@@ -206,37 +388,49 @@ int main(int argc, char** argv) {
                 if (key == SDLK_ESCAPE) {  // ESC toggles UI
                     showUI = !showUI;
                 } else if (key == SDLK_F5) {  // F5 pause
-                    paused = !paused;
+                    if (hasGame) togglePause();
                 } else if (key == SDLK_F1) {  // F1 reset (power cycle is safer here)
-                    if (hasGame) hasGame = loadAndBoot(initialRomPath.empty() ? romList.empty() ? "" : romList[selectedRom]
-                                                                              : initialRomPath);
+                    if (hasGame) post(EmuCommand::Reset);
                 } else if (key == SDLK_F2) {  // NEW: Toggle ROM Browser window only
                     browserOpen = !browserOpen;
+                } else if (key == SDLK_F4) {  // turbo on/off
+                    setTurbo(!emu->turbo);
                 }
             }
 
             // Controller hotplug
             if (e.type == SDL_CONTROLLERDEVICEADDED) {
-                if (nes.input && !nes.input->controller && SDL_IsGameController(e.cdevice.which)) {
-                    nes.input->controller = SDL_GameControllerOpen(e.cdevice.which);
+                if (!controller && SDL_IsGameController(e.cdevice.which)) {
+                    controller = SDL_GameControllerOpen(e.cdevice.which);
                 }
             }
             if (e.type == SDL_CONTROLLERDEVICEREMOVED) {
-                if (nes.input && nes.input->controller) {
-                    SDL_GameControllerClose(nes.input->controller);
-                    nes.input->controller = nullptr;
+                if (controller) {
+                    SDL_GameControllerClose(controller);
+                    controller = nullptr;
                 }
             }
         }
 
-        // ------------------ Emulator step ------------------
-        if (hasGame && !paused) {
-            nes.runFrame();
-        }
-
-        // Upload the current framebuffer (even if paused)
-        if (nes.ppu) {
-            uploadNESFrame(tex, nes.ppu->framebuffer);
+        // ------------------ Publish input ------------------
+        // The emulation thread latches this at the start of its next frame
+        emu->pad.publish(readHostPad(controller),
+                         SDL_GetPerformanceCounter() * 1000000ull / SDL_GetPerformanceFrequency());
+
+        // Upload only when the video worker finished a new frame; it does not
+        // republish frames identical to the one on screen
+        if (emu->video.frames.update()) {
+            const VideoFrame& f = emu->video.frames.readBuffer();
+            if (f.width != texW || f.height != texH) {
+                SDL_Texture* t = SDL_CreateTexture(ren, texFormat, SDL_TEXTUREACCESS_STREAMING, f.width, f.height);
+                if (t) {
+                    SDL_DestroyTexture(tex);
+                    tex = t;
+                    texW = f.width;
+                    texH = f.height;
+                }
+            }
+            if (f.width == texW && f.height == texH) uploadNESFrame(tex, f, emu->video.outputPalette());
         }
 
         // ------------------ Build UI ------------------
@@ -249,11 +443,7 @@ int main(int argc, char** argv) {
                         // (No native OS dialog here; keep it portable)
                     }
                     if (timgui::MenuItem("Reset", hasGame)) {
-                        if (hasGame) {
-                            // power cycle is simplest & safest
-                            hasGame = loadAndBoot(initialRomPath.empty() ? (romList.empty() ? "" : romList[selectedRom])
-                                                                         : initialRomPath);
-                        }
+                        if (hasGame) post(EmuCommand::Reset);
                     }
                     timgui::MenuSeparator();
                     if (timgui::MenuItem("Quit")) running = false;
@@ -273,6 +463,10 @@ int main(int argc, char** argv) {
                         browserOpen = !browserOpen;
                     }
 
+                    if (timgui::MenuItem("Performance overlay", true, showPerf ? "On" : "Off")) {
+                        showPerf = !showPerf;
+                    }
+
                     // Scale filter submenu (unchanged)
                     int prevFilter = scaleFilter;
                     if (timgui::BeginSubMenu("Scale filter")) {
@@ -284,12 +478,64 @@ int main(int argc, char** argv) {
                         setScaleQuality(scaleFilter == 1);
                     }
 
+                    // Video filter submenu: applied by the video worker before upload
+                    int prevVideoFilter = videoFilter;
+                    if (timgui::BeginSubMenu("Video filter")) {
+                        (void)timgui::RadioButton("None", &videoFilter, FilterNone);
+                        (void)timgui::RadioButton("NTSC composite", &videoFilter, FilterNtsc);
+                        (void)timgui::RadioButton("Scale2x", &videoFilter, FilterScale2x);
+                        (void)timgui::RadioButton("Scale3x", &videoFilter, FilterScale3x);
+                        (void)timgui::RadioButton("xBR-lite (2x)", &videoFilter, FilterXbrLite);
+                        timgui::EndSubMenu();
+                    }
+                    if (prevVideoFilter != videoFilter) {
+                        setVideoFilter(emu->video, videoFilter, paletteLayout(texFormat));
+                    }
+
                     timgui::EndMenu();
                 }
 
                 if (timgui::BeginMenu("Emulator")) {
                     if (timgui::MenuItem(paused ? "Resume (F5)" : "Pause (F5)", hasGame)) {
-                        paused = !paused;
+                        togglePause();
+                    }
+                    if (timgui::MenuItem("Turbo (F4)", true, emu->turbo ? "On" : "Off",
+                                         "Run uncapped, show every Nth frame")) {
+                        setTurbo(!emu->turbo);
+                    }
+                    int turboFactor = emu->turboFactor;
+                    if (timgui::BeginSubMenu("Turbo speed")) {
+                        (void)timgui::RadioButton("2x", &turboFactor, 2);
+                        (void)timgui::RadioButton("4x", &turboFactor, 4);
+                        (void)timgui::RadioButton("8x", &turboFactor, 8);
+                        (void)timgui::RadioButton("16x", &turboFactor, 16);
+                        timgui::EndSubMenu();
+                    }
+                    if (turboFactor != emu->turboFactor) {
+                        post(EmuCommand::SetTurboFactor, turboFactor);
+                    }
+                    if (timgui::MenuItem("Adaptive frameskip", true, emu->adaptiveSkip ? "On" : "Off",
+                                         "Skip drawing frames the display can't show in time")) {
+                        post(EmuCommand::SetAdaptiveSkip, emu->adaptiveSkip ? 0 : 1);
+                    }
+                    int audioQuality = emu->audioQuality;
+                    if (timgui::BeginSubMenu("Audio quality")) {
+                        (void)timgui::RadioButton("Low (8 taps)", &audioQuality, (int)Resampler::Quality::Low);
+                        (void)timgui::RadioButton("Medium (16 taps)", &audioQuality, (int)Resampler::Quality::Medium);
+                        (void)timgui::RadioButton("High (32 taps)", &audioQuality, (int)Resampler::Quality::High);
+                        timgui::EndSubMenu();
+                    }
+                    if (audioQuality != emu->audioQuality) {
+                        post(EmuCommand::SetAudioQuality, audioQuality);
+                    }
+                    if (timgui::MenuItem("Audio thread", true, emu->threadedAudio ? "On" : "Off",
+                                         "Synthesize audio on its own core (applies on reset)")) {
+                        post(EmuCommand::SetThreadedAudio, emu->threadedAudio ? 0 : 1);
+                    }
+                    const bool binned = emu->spriteEval == (int)PPU::SpriteEval::Binned;
+                    if (timgui::MenuItem("Sprite evaluation", true, binned ? "Binned" : "Scan",
+                                         "Binned: sort OAM into lines once per change; Scan: test all 64 every line")) {
+                        post(EmuCommand::SetSpriteEval, (int)(binned ? PPU::SpriteEval::Scan : PPU::SpriteEval::Binned));
                     }
                     timgui::MenuSeparator();
                     timgui::TextF("FPS: %.1f", fps);
@@ -298,6 +544,7 @@ int main(int argc, char** argv) {
 
                 if (timgui::BeginMenu("Help")) {
                     (void)timgui::MenuItem("F5 = Pause/Resume");
+                    (void)timgui::MenuItem("F4 = Turbo on/off");
                     (void)timgui::MenuItem("F1 = Reset current ROM");
                     (void)timgui::MenuItem("Esc = Toggle UI");
                     timgui::EndMenu();
@@ -322,23 +569,57 @@ int main(int argc, char** argv) {
                 }
                 timgui::NewLine();
                 if (timgui::Button("Scan")) {
-                    romFolder = std::string(folderBuf);
-                    romList = listNES(romFolder);
+                    selectPath.clear();
                     selectedRom = 0;
+                    scanFolder(std::string(folderBuf));
                 }
+                if (library.scanning())
+                    timgui::TextF("Scanning... %zu found, %zu new or changed", library.filesSeen(),
+                                  library.filesHashed());
+                else
+                    timgui::TextF("%zu ROMs", romList.size());
 
                 timgui::Separator();
 
-                // Build short names and show a clean ListBox (no child panel — avoids overlap)
-                std::vector<std::string> shortNames;
-                shortNames.reserve(romList.size());
-                for (auto& s : romList) shortNames.push_back(baseName(s));
+                // Short names (relative to the folder) only change with the listing
+                if (library.version() != romListVersion) {
+                    std::string keep = selectPath;
+                    if (keep.empty() && selectedRom >= 0 && selectedRom < (int)romList.size())
+                        keep = romList[selectedRom].path;
+                    romListVersion = library.snapshot(romList);
+                    std::error_code ec;
+                    const fs::path root = fs::absolute(romFolder, ec).lexically_normal();
+                    shortNames.clear();
+                    shortNames.reserve(romList.size());
+                    selectedRom = std::min(selectedRom, std::max(0, (int)romList.size() - 1));
+                    for (size_t i = 0; i < romList.size(); ++i) {
+                        const RomEntry& e = romList[i];
+                        std::string name = fs::path(e.path).lexically_relative(root).string();
+                        if (name.empty()) name = baseName(e.path);
+                        if (!e.valid) name += " (not iNES)";
+                        shortNames.push_back(std::move(name));
+                        if (e.path == keep) {
+                            selectedRom = (int)i;
+                            selectPath.clear();
+                        }
+                    }
+                }
+
+                timgui::Checkbox("Previews", &showPreviews);
 
-                // Choose a sensible number of visible rows (min 6, max 22)
-                int visibleRows = std::clamp((int)shortNames.size(), 6, 22);
-                if (timgui::ListBox("ROMs", &selectedRom, shortNames, visibleRows)) {
-                    // selection changed (optional: preview or status)
+                // Choose a sensible number of visible rows (min 6, max 22; fewer, taller ones with previews)
+                bool picked;
+                if (showPreviews) {
+                    int visibleRows = std::clamp((int)shortNames.size(), 3, 6);
+                    picked = timgui::ListBox(
+                        "ROMs", &selectedRom, shortNames, visibleRows,
+                        [&](int i) { return thumbTexture(romList[i]); }, RomThumbnails::kWidth * 0.75f,
+                        RomThumbnails::kHeight * 0.75f);
+                } else {
+                    int visibleRows = std::clamp((int)shortNames.size(), 6, 22);
+                    picked = timgui::ListBox("ROMs", &selectedRom, shortNames, visibleRows);
                 }
+                if (picked) selectPath.clear();  // the user's pick wins over a pending one
 
                 timgui::Separator();
 
@@ -348,23 +629,20 @@ int main(int argc, char** argv) {
                     if (timgui::Button("Load")) {
                         if (selectedRom >= 0 && selectedRom < (int)romList.size()) {
                             initialRomPath.clear();
-                            hasGame = loadAndBoot(romList[selectedRom]);
-                            paused = false;
+                            loadAndBoot(romList[selectedRom].path);
                         }
                     }
                     timgui::NextColumn();
 
                     if (timgui::Button(paused ? "Resume" : "Pause")) {
-                        if (hasGame) paused = !paused;
+                        if (hasGame) togglePause();
                     }
                     timgui::NextColumn();
 
                     if (timgui::Button("Reset")) {
                         if (hasGame) {
-                            hasGame = loadAndBoot(initialRomPath.empty()
-                                                      ? (romList.empty() ? "" : romList[selectedRom])
-                                                      : initialRomPath);
-                            paused = false;
+                            post(EmuCommand::Reset);
+                            post(EmuCommand::Resume);
                         }
                     }
                 }
@@ -376,7 +654,7 @@ int main(int argc, char** argv) {
                     timgui::TextF("Running: %s",
                                   initialRomPath.empty()
                                       ? ((selectedRom >= 0 && selectedRom < (int)romList.size())
-                                             ? baseName(romList[selectedRom]).c_str()
+                                             ? baseName(romList[selectedRom].path).c_str()
                                              : "(unknown)")
                                       : baseName(initialRomPath).c_str());
                 } else {
@@ -385,6 +663,28 @@ int main(int argc, char** argv) {
             }
             timgui::End();
 
+            // Performance overlay
+            if (showPerf && timgui::Begin("Performance", &showPerf, 560, 60, 300, 280)) {
+                timgui::TextF("Display FPS: %.1f", fps);
+                timgui::TextF("Emulated FPS: %.1f", emu->emuFps.load());
+                timgui::TextF("Emu loop: %.2f ms", emu->loopMs.load());
+                timgui::TextF("Frames/loop: %d (%d skipped)", emu->lastRun.load(), emu->lastSkipped.load());
+                timgui::TextF("Skipped total: %llu", (unsigned long long)emu->totalSkipped.load());
+                timgui::TextF("Turbo: %s", emu->turbo ? "on" : "off");
+                timgui::TextF("Video worker: %.2f ms (%llu dropped, %llu unchanged)", emu->video.workMs.load(),
+                              (unsigned long long)emu->video.dropped.load(),
+                              (unsigned long long)emu->video.unchanged.load());
+                if (videoFilter != FilterNone)
+                    timgui::TextF("Filter: %s %.2f ms (%d threads)", videoFilterName(videoFilter),
+                                  emu->video.filterMs.load(), emu->video.pool.threads());
+                timgui::TextF("Audio latency: %.1f ms (rate %+.2f%%)", emu->audioLatencyMs.load(),
+                              emu->audioRateAdjust.load() * 100.0);
+                timgui::TextF("Underruns: %llu  Overruns: %llu",
+                              (unsigned long long)emu->audioUnderruns.load(),
+                              (unsigned long long)emu->audioOverruns.load());
+            }
+            timgui::End();
+
         }  // showUI
 
         timgui::EndFrame();
@@ -394,7 +694,7 @@ int main(int argc, char** argv) {
         SDL_RenderClear(ren);
 
         // NES frame as the "background"
-        SDL_Rect dst = letterboxDest(win, baseW, baseH, integerScale);
+        SDL_Rect dst = letterboxDest(win, baseW, baseH, std::max(1, texH / baseH), integerScale);
         SDL_RenderCopy(ren, tex, nullptr, &dst);
 
         // Overlay GUI
@@ -415,11 +715,18 @@ int main(int argc, char** argv) {
     timgui::DestroyContext();
     SDL_StopTextInput();
 
-    if (nes.input && nes.input->controller) {
-        SDL_GameControllerClose(nes.input->controller);
-        nes.input->controller = nullptr;
+    // Stop emulation first: flushes battery RAM and closes the audio device
+    emu->stop();
+    emu.reset();
+
+    if (controller) {
+        SDL_GameControllerClose(controller);
+        controller = nullptr;
     }
 
+    for (auto& t : thumbTextures)
+        if (t.second.tex) SDL_DestroyTexture(t.second.tex);
+
     SDL_DestroyTexture(tex);
     SDL_DestroyRenderer(ren);
     SDL_DestroyWindow(win);
@@ -0,0 +1,57 @@
+// mapped_file.cpp
+#include "mapped_file.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+#include <filesystem>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string& path) {
+    close();
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(std::filesystem::path(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        if (HANDLE m = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+            ptr = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(m);  // the view keeps the mapping alive
+            len = ptr ? (size_t)size.QuadPart : 0;
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            ptr = p;
+            len = (size_t)st.st_size;
+        }
+    }
+    ::close(fd);  // the mapping keeps the file alive
+#endif
+    return ptr != nullptr;
+}
+
+void MappedFile::close() {
+    if (!ptr) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(ptr);
+#else
+    ::munmap(ptr, len);
+#endif
+    ptr = nullptr;
+    len = 0;
+}
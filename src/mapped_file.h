@@ -0,0 +1,27 @@
+// mapped_file.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only mapping of a whole file (mmap / MapViewOfFile). The pages are
+// shared with the OS file cache and faulted in on first touch.
+class MappedFile {
+   public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False if the file can't be mapped: missing, empty, not a regular file
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return ptr != nullptr; }
+    const uint8_t* data() const { return static_cast<const uint8_t*>(ptr); }
+    size_t size() const { return len; }
+
+   private:
+    void* ptr = nullptr;
+    size_t len = 0;
+};
@@ -11,6 +11,9 @@ struct Mapper {
     virtual void    cpuWrite(uint16_t a, uint8_t v) = 0;
     virtual uint8_t ppuRead(uint16_t a) = 0;
     virtual void    ppuWrite(uint16_t a, uint8_t v) = 0;
+    // Host pointer to the 256 bytes of CPU page `a & 0xFF00` when reading them
+    // has no side effects (ROM, RAM); nullptr = go through cpuRead (OAM DMA)
+    virtual const uint8_t* cpuReadPage(uint16_t /*a*/) { return nullptr; }
 
     // PPU nametable mirroring (0=horiz, 1=vert; extend if you add 4-screen/single-screen)
     virtual uint8_t mirroring() const = 0;
@@ -18,8 +21,9 @@ struct Mapper {
     // IRQ + PPU A12 clocking (MMC3)
     virtual bool    irqPending() const { return false; }
     virtual void    irqAck() {}
-    virtual void ppuA12Clock(bool /*level*/) {}
-    virtual void ppuOnScanlineDot260(bool /*rendering*/) {}  // default no-op
+    // A12 rising edge after the low-time filter, at most one per scanline
+    // (the PPU does the filtering; see PPU::a12High)
+    virtual void ppuA12Rise() {}
 
     // PRG-RAM surface for battery saves
     virtual uint8_t* prgRamData() { return nullptr; }
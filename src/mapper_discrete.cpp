@@ -0,0 +1,109 @@
+// mapper_discrete.cpp
+#include "mapper_discrete.h"
+
+namespace {
+
+constexpr int8_t kHeader = DiscreteBoard::kHeaderMirroring;
+//                                    conflicts  PRG shift/mask/KB  CHR shift/mask  mirroring
+constexpr DiscreteBoard kUxROM       {true,      0, 0xFF, 16,       0, 0x00,        kHeader};
+constexpr DiscreteBoard kCNROM       {true,      0, 0x00, 32,       0, 0xFF,        kHeader};
+constexpr DiscreteBoard kAxROM       {false,     0, 0x07, 32,       0, 0x00,        4};
+constexpr DiscreteBoard kColorDreams {true,      0, 0x03, 32,       4, 0x0F,        kHeader};
+constexpr DiscreteBoard kBNROM       {true,      0, 0xFF, 32,       0, 0x00,        kHeader};
+constexpr DiscreteBoard kGxROM       {true,      4, 0x03, 32,       0, 0x03,        kHeader};
+
+// Points `count` consecutive slots of `slotSize` bytes at bank `bank` (in
+// units of count * slotSize), wrapping by the memory size like the boards'
+// unconnected high address lines do
+void mapSlots(const uint8_t** slots, int count, uint32_t slotSize, RomSpan mem, uint32_t bank) {
+    const uint32_t units = (uint32_t)mem.size() / slotSize;
+    for (int s = 0; s < count; ++s) slots[s] = &mem[(size_t)((bank * count + s) % units) * slotSize];
+}
+
+template <const DiscreteBoard& B>
+struct MapperDiscrete : Mapper {
+    RomSpan prg, chr;  // chr is CHR-ROM, or chrRAM
+    std::vector<uint8_t> chrRAM;
+    bool chrIsRAM = false;
+    bool busConflicts = B.busConflicts;
+    uint8_t mir = 0;
+
+    // 8 KiB PRG slots at $8000/$A000/$C000/$E000, 1 KiB CHR slots at $0000-$1C00
+    const uint8_t* prgSlot[4] = {};
+    const uint8_t* chrSlot[8] = {};
+
+    MapperDiscrete(RomSpan prg_, RomSpan chr_, uint32_t chrRamKB, uint8_t mir_)
+        : prg(prg_), chr(chr_), chrIsRAM(chr_.empty()), mir(mir_) {
+        if (chrIsRAM) {
+            chrRAM.assign((chrRamKB ? chrRamKB : 8) * 1024, 0);
+            chr = chrRAM;
+        }
+        latch(0);
+    }
+
+    void latch(uint8_t v) {
+        const uint32_t prgBank = (uint32_t)(v >> B.prgShift) & B.prgMask;
+        if (B.prgKB == 16) {
+            mapSlots(&prgSlot[0], 2, 0x2000, prg, prgBank);
+            mapSlots(&prgSlot[2], 2, 0x2000, prg, (uint32_t)(prg.size() / 0x4000) - 1);  // last 16 KiB
+        } else {
+            mapSlots(&prgSlot[0], 4, 0x2000, prg, prgBank);
+        }
+        mapSlots(&chrSlot[0], 8, 0x0400, chr, (uint32_t)(v >> B.chrShift) & B.chrMask);
+        if (B.mirrorBit != DiscreteBoard::kHeaderMirroring) mir = ((v >> B.mirrorBit) & 1) ? 3 : 2;
+    }
+
+    uint8_t cpuRead(uint16_t a) override {
+        if (a < 0x8000) return 0xFF;
+        return prgSlot[(a >> 13) & 3][a & 0x1FFF];
+    }
+    void cpuWrite(uint16_t a, uint8_t v) override {
+        if (a < 0x8000) return;
+        if (busConflicts) v &= prgSlot[(a >> 13) & 3][a & 0x1FFF];
+        latch(v);
+    }
+    const uint8_t* cpuReadPage(uint16_t a) override {
+        if (a < 0x8000) return nullptr;
+        return prgSlot[(a >> 13) & 3] + (a & 0x1F00);
+    }
+    uint8_t ppuRead(uint16_t a) override {
+        if (a >= 0x2000) return 0;
+        return chrSlot[a >> 10][a & 0x03FF];
+    }
+    void ppuWrite(uint16_t a, uint8_t v) override {
+        if (a >= 0x2000 || !chrIsRAM) return;
+        const_cast<uint8_t*>(chrSlot[a >> 10])[a & 0x03FF] = v;  // into chrRAM
+    }
+    uint8_t mirroring() const override { return mir; }
+};
+
+template <const DiscreteBoard& B>
+std::shared_ptr<Mapper> create(const RomHeader& h, RomSpan prg, RomSpan chr) {
+    auto m = std::make_shared<MapperDiscrete<B>>(prg, chr, h.chrRamKB, h.mirroring);
+    if (h.mapperId == 2 || h.mapperId == 3 || h.mapperId == 7) {
+        if (h.submapper == 1) m->busConflicts = false;
+        if (h.submapper == 2) m->busConflicts = true;
+    }
+    if (h.hints & kHintNoBusConflicts) m->busConflicts = false;
+    return m;
+}
+
+struct BoardEntry {
+    uint16_t mapperId;
+    std::shared_ptr<Mapper> (*create)(const RomHeader&, RomSpan, RomSpan);
+};
+constexpr BoardEntry kBoards[] = {
+    {2, &create<kUxROM>},       {3, &create<kCNROM>}, {7, &create<kAxROM>},
+    {11, &create<kColorDreams>}, {34, &create<kBNROM>}, {66, &create<kGxROM>},
+};
+
+}  // namespace
+
+std::shared_ptr<Mapper> makeDiscreteMapper(const RomHeader& h, RomSpan prg, RomSpan chr) {
+    if (prg.size() < 0x4000 || prg.size() % 0x2000 || chr.size() % 0x0400) return nullptr;
+    // Mapper 34 with more than 8 KiB of CHR-ROM is NINA-001, a different board
+    if (h.mapperId == 34 && chr.size() > 0x2000) return nullptr;
+    for (const BoardEntry& b : kBoards)
+        if (b.mapperId == h.mapperId) return b.create(h, prg, chr);
+    return nullptr;
+}
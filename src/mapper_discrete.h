@@ -0,0 +1,30 @@
+// mapper_discrete.h
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "mapper.h"
+#include "rom_image.h"
+
+// Discrete-logic boards: a single latch written anywhere in $8000-$FFFF whose
+// bit fields select the PRG bank, the CHR bank and, on some boards,
+// single-screen mirroring. Each board is a DiscreteBoard description; the
+// mapper is instantiated per board, so updating its bank slots compiles down
+// to fixed shifts and masks.
+//   2 UxROM, 3 CNROM, 7 AxROM, 11 Color Dreams, 34 BNROM, 66 GxROM
+struct DiscreteBoard {
+    static constexpr int8_t kHeaderMirroring = -1;
+
+    bool busConflicts;         // default: the latch sees the written value ANDed with the ROM byte
+    uint8_t prgShift, prgMask;  // PRG bank field of the latch
+    uint8_t prgKB;             // 16: switchable $8000, last bank fixed at $C000; 32: whole window
+    uint8_t chrShift, chrMask;  // 8 KiB CHR bank field (mask 0: fixed)
+    int8_t mirrorBit;          // latch bit selecting single-screen A/B, or kHeaderMirroring
+};
+
+// nullptr if the header's mapper is not a discrete board handled here.
+// CHR-RAM of chrRamKB (8 if 0) when `chr` is empty. NES 2.0 submappers 1/2
+// of mappers 2, 3 and 7 and kHintNoBusConflicts override the board's bus
+// conflicts.
+std::shared_ptr<Mapper> makeDiscreteMapper(const RomHeader& h, RomSpan prg, RomSpan chr);
@@ -1,6 +1,8 @@
 // mapper_mmc1.cpp
 #include "mapper_mmc1.h"
 
+#include <stdexcept>
+
 inline uint32_t chrSizeMask(uint32_t sz) {  // sz is bytes
     // chr.size() or chrRAM.size() can be non power-of-two; just modulo later is fine
     return sz - 1;
@@ -27,19 +29,19 @@ static inline uint32_t mmc1_map_chr(uint16_t a, uint8_t ctrl,
 // ------------------------
 // MMC1 constructor
 // ------------------------
-MapperMMC1::MapperMMC1(std::vector<uint8_t> prg_, std::vector<uint8_t> chr_,
-                       bool chrRam, uint8_t mir_, uint32_t prgRamKB)
-    : prg(std::move(prg_)),
-      chr(std::move(chr_)),  // keep CHR-ROM data here if present
-      chrIsRAM(chrRam || chr.empty()),
+MapperMMC1::MapperMMC1(RomSpan prg_, RomSpan chr_,
+                       uint32_t chrRamKB, uint8_t mir_, uint32_t prgRamKB)
+    : prg(prg_),
+      chr(chr_),  // CHR-ROM in the image, if present
+      chrIsRAM(chr_.empty()),
       mir(mir_) {
+    // Banks resolve to slot pointers, which needs whole 8 KiB PRG and 1 KiB
+    // CHR banks (NES 2.0 exponent sizes need not be)
+    if (prg.empty() || prg.size() % 0x2000 || chr.size() % 0x0400)
+        throw std::runtime_error("MMC1: PRG/CHR size is not a whole number of banks");
     if (chrIsRAM) {
-        if (chrRAM.empty()) {
-            // If the loader already sized 'chr' for RAM, mirror that;
-            // otherwise default to 8KB.
-            size_t sz = chr.size() ? chr.size() : (8 * 1024);
-            chrRAM.assign(sz, 0);
-        }
+        chrRAM.assign((chrRamKB ? chrRamKB : 8) * 1024, 0);
+        chr = chrRAM;
     }
 
     prgRamPresent = true;
@@ -53,6 +55,18 @@ MapperMMC1::MapperMMC1(std::vector<uint8_t> prg_, std::vector<uint8_t> chr_,
     chrBank0 = 0;
     chrBank1 = 0;
     prgRamWriteEnabled = true;
+    updateBanks();
+}
+
+void MapperMMC1::updateBanks() {
+    // The constructor checked the ROM sizes, so each slot is contiguous
+    for (int s = 0; s < 4; ++s) prgSlot[s] = &prg[prgOffset((uint16_t)(0x8000 + s * 0x2000))];
+    for (int s = 0; s < 8; ++s) chrSlot[s] = &chr[chrOffset((uint16_t)(s * 0x0400))];
+}
+
+uint32_t MapperMMC1::chrOffset(uint16_t a) const {
+    const uint32_t idx = mmc1_map_chr(a, ctrl, chrBank0, chrBank1);
+    return idx % (uint32_t)chr.size();
 }
 
 // MMC1 mirroring decoding:
@@ -75,20 +89,14 @@ uint8_t MapperMMC1::mirroring() const {
 // ------------------------
 // CPU bus
 // ------------------------
-uint8_t MapperMMC1::cpuRead(uint16_t a) {
-    if (a >= 0x6000 && a < 0x8000) {
-        if (!prgRamPresent) return 0xFF;
-        return prgRAM[a - 0x6000];
-    }
-    if (a < 0x8000) return 0xFF;
-
+uint32_t MapperMMC1::prgOffset(uint16_t a) const {
     const uint8_t prgMode = (ctrl >> 2) & 0x03;
     const size_t prgSize = prg.size();
     const size_t num16k = prgSize / 0x4000 ? prgSize / 0x4000 : 1;
 
-    auto rd16 = [&](uint32_t bank, uint16_t off) -> uint8_t {
+    auto rd16 = [&](uint32_t bank, uint16_t off) -> uint32_t {
         uint32_t base = (bank % num16k) * 0x4000u;
-        return prg[(base + (off & 0x3FFFu)) % prgSize];
+        return (uint32_t)((base + (off & 0x3FFFu)) % prgSize);
     };
 
     if (prgMode <= 1) {
@@ -105,9 +113,29 @@ uint8_t MapperMMC1::cpuRead(uint16_t a) {
     }
 }
 
+uint8_t MapperMMC1::cpuRead(uint16_t a) {
+    if (a >= 0x6000 && a < 0x8000) {
+        if (!prgRamPresent) return 0xFF;
+        return prgRAM[(a - 0x6000) % prgRAM.size()];  // under 8 KiB (NES 2.0) mirrors
+    }
+    if (a < 0x8000) return 0xFF;
+    return prgSlot[(a >> 13) & 3][a & 0x1FFF];
+}
+
+const uint8_t* MapperMMC1::cpuReadPage(uint16_t a) {
+    a &= 0xFF00;
+    if (a >= 0x6000 && a < 0x8000) {
+        const size_t off = (a - 0x6000) % prgRAM.size();
+        if (!prgRamPresent || off + 0x100 > prgRAM.size()) return nullptr;
+        return &prgRAM[off];
+    }
+    if (a < 0x8000) return nullptr;
+    return prgSlot[(a >> 13) & 3] + (a & 0x1FFF);
+}
+
 void MapperMMC1::cpuWrite(uint16_t a, uint8_t v) {
     if (a >= 0x6000 && a < 0x8000) {
-        if (prgRamPresent && prgRamWriteEnabled) prgRAM[a - 0x6000] = v;
+        if (prgRamPresent && prgRamWriteEnabled) prgRAM[(a - 0x6000) % prgRAM.size()] = v;
         return;
     }
     if (a < 0x8000) return;
@@ -117,6 +145,7 @@ void MapperMMC1::cpuWrite(uint16_t a, uint8_t v) {
         loadReg = 0;
         loadCount = 0;
         ctrl |= 0x0C;  // fix PRG banking to last page
+        updateBanks();
         return;
     }
 
@@ -147,6 +176,7 @@ int reg = ((a - 0x8000) >> 13) & 0x03;   // ✅ 0:ctrl, 1:CHR0, 2:CHR1, 3:PRG
             prgRamWriteEnabled = ((data & 0x10) == 0);
         } break;
     }
+    updateBanks();
     // Clear for next sequence
     loadReg = 0;
     loadCount = 0;
@@ -157,15 +187,12 @@ int reg = ((a - 0x8000) >> 13) & 0x03;   // ✅ 0:ctrl, 1:CHR0, 2:CHR1, 3:PRG
 // READ
 uint8_t MapperMMC1::ppuRead(uint16_t a) {
     if (a >= 0x2000) return 0;
-    const uint32_t idx = mmc1_map_chr(a, ctrl, chrBank0, chrBank1);
-    if (chrIsRAM)  return chrRAM[idx % chrRAM.size()];
-    else           return chr[idx   % chr.size()];
+    return chrSlot[a >> 10][a & 0x03FF];
 }
 
 // WRITE
 void MapperMMC1::ppuWrite(uint16_t a, uint8_t v) {
     if (a >= 0x2000) return;
     if (!chrIsRAM)   return;                    // CHR-ROM ignores writes
-    const uint32_t idx = mmc1_map_chr(a, ctrl, chrBank0, chrBank1);
-    chrRAM[idx % chrRAM.size()] = v;
+    const_cast<uint8_t*>(chrSlot[a >> 10])[a & 0x03FF] = v;  // into chrRAM
 }
\ No newline at end of file
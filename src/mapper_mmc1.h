@@ -3,9 +3,10 @@
 #include <vector>
 
 #include "mapper.h"
+#include "rom_image.h"
 
 struct MapperMMC1 : Mapper {
-    std::vector<uint8_t> prg, chr;
+    RomSpan prg, chr;  // chr is CHR-ROM, or chrRAM
     std::vector<uint8_t> chrRAM;
     std::vector<uint8_t> prgRAM;
 
@@ -22,15 +23,27 @@ struct MapperMMC1 : Mapper {
     bool prgRamPresent = false;
     bool prgRamWriteEnabled = true;
 
-    MapperMMC1(std::vector<uint8_t> prg_, std::vector<uint8_t> chr_, bool chrRam, uint8_t mir_, uint32_t prgRamKB);
+    // Banks resolved to host pointers: 8 KiB PRG slots at $8000/$A000/$C000/$E000,
+    // 1 KiB CHR slots at $0000-$1C00. Rebuilt by updateBanks() whenever a
+    // shift-register commit or reset changes them.
+    const uint8_t* prgSlot[4] = {};
+    const uint8_t* chrSlot[8] = {};
+
+    // CHR-RAM of chrRamKB (8 if 0) when `chr_` is empty
+    MapperMMC1(RomSpan prg_, RomSpan chr_, uint32_t chrRamKB, uint8_t mir_, uint32_t prgRamKB);
 
     uint8_t cpuRead(uint16_t a) override;
     void cpuWrite(uint16_t a, uint8_t v) override;
     uint8_t ppuRead(uint16_t a) override;
     void ppuWrite(uint16_t a, uint8_t v) override;
     uint8_t mirroring() const override;
+    const uint8_t* cpuReadPage(uint16_t a) override;
 
     // Save surface
     uint8_t* prgRamData() override { return prgRAM.empty() ? nullptr : prgRAM.data(); }
     size_t prgRamSize() const override { return prgRAM.size(); }
+
+    void updateBanks();
+    uint32_t prgOffset(uint16_t a) const;  // index into prg for a >= $8000
+    uint32_t chrOffset(uint16_t a) const;  // index into chr for a < $2000
 };
@@ -1,63 +1,92 @@
 // mapper_mmc3.cpp
 #include "mapper_mmc3.h"
 
-static inline uint32_t prgBankAddr(const std::vector<uint8_t>& prg, uint32_t bank, uint32_t off) {
+#include <stdexcept>
+
+static inline uint32_t prgBankAddr(RomSpan prg, uint32_t bank, uint32_t off) {
     if (prg.empty()) return 0;
     uint32_t bankCount = (uint32_t)prg.size() / 0x2000u;
     uint32_t b = bankCount ? (bank % bankCount) : 0;
     return (b * 0x2000u + (off & 0x1FFFu)) % (uint32_t)prg.size();
 }
 
-MapperMMC3::MapperMMC3(std::vector<uint8_t> prg_, std::vector<uint8_t> chr_, uint8_t mir_, uint32_t prgRamKB)
-    : prg(std::move(prg_)), chr(std::move(chr_)), mir(mir_) {
+MapperMMC3::MapperMMC3(RomSpan prg_, RomSpan chr_, uint32_t chrRamKB, uint8_t mir_, uint32_t prgRamKB)
+    : prg(prg_), chr(chr_), mir(mir_) {
+    // Banks resolve to slot pointers, which needs whole 8 KiB PRG and 1 KiB
+    // CHR banks (NES 2.0 exponent sizes need not be)
+    if (prg.empty() || prg.size() % 0x2000 || chr.size() % 0x0400)
+        throw std::runtime_error("MMC3: PRG/CHR size is not a whole number of banks");
     bank.fill(0);
 
-    chrIsRAM = chr.empty();              // <-- true only if no CHR ROM in the file
-    if (chrIsRAM) chr.resize(8 * 1024);  // allocate 8K CHR-RAM
+    chrIsRAM = chr.empty();  // no CHR-ROM in the file
+    if (chrIsRAM) {
+        chrRAM.assign((chrRamKB ? chrRamKB : 8) * 1024, 0);
+        chr = chrRAM;
+    }
 
     prgRAM.resize(prgRamKB ? prgRamKB * 1024 : 8 * 1024);
     prgRAMEnable = 0x80;
+    updateBanks();
+}
+
+void MapperMMC3::updateBanks() {
+    // The constructor checked the ROM sizes, so each slot is contiguous
+    for (int s = 0; s < 4; ++s) prgSlot[s] = &prg[prgOffset((uint16_t)(0x8000 + s * 0x2000))];
+    for (int s = 0; s < 8; ++s) chrSlot[s] = &chr[chrOffset((uint16_t)(s * 0x0400))];
+}
+
+uint32_t MapperMMC3::prgOffset(uint16_t a) const {
+    uint32_t off = a & 0x1FFF;
+    uint8_t b6 = bank[6] & 0x3F;
+    uint8_t b7 = bank[7] & 0x3F;
+    uint32_t last = (uint32_t)prg.size() / 0x2000 - 1;
+
+    if (!prgMode) {
+        if (a < 0xA000)
+            return prgBankAddr(prg, b6, off);
+        else if (a < 0xC000)
+            return prgBankAddr(prg, b7, off);
+        else if (a < 0xE000)
+            return prgBankAddr(prg, last - 1, off);
+        else
+            return prgBankAddr(prg, last, off);
+    } else {
+        if (a < 0xA000)
+            return prgBankAddr(prg, last - 1, off);
+        else if (a < 0xC000)
+            return prgBankAddr(prg, b7, off);
+        else if (a < 0xE000)
+            return prgBankAddr(prg, b6, off);
+        else
+            return prgBankAddr(prg, last, off);
+    }
 }
 
 uint8_t MapperMMC3::cpuRead(uint16_t a) {
     if (a >= 0x6000 && a < 0x8000) {
-        // Reads usually allowed even if writes are disabled
-        return prgRAM[a - 0x6000];
-    }
-    if (a >= 0x8000) {
-        uint32_t off = a & 0x1FFF;
-        uint8_t b6 = bank[6] & 0x3F;
-        uint8_t b7 = bank[7] & 0x3F;
-        uint32_t last = (uint32_t)prg.size() / 0x2000 - 1;
-
-        if (!prgMode) {
-            if (a < 0xA000)
-                return prg[prgBankAddr(prg, b6, off)];
-            else if (a < 0xC000)
-                return prg[prgBankAddr(prg, b7, off)];
-            else if (a < 0xE000)
-                return prg[prgBankAddr(prg, last - 1, off)];
-            else
-                return prg[prgBankAddr(prg, last, off)];
-        } else {
-            if (a < 0xA000)
-                return prg[prgBankAddr(prg, last - 1, off)];
-            else if (a < 0xC000)
-                return prg[prgBankAddr(prg, b7, off)];
-            else if (a < 0xE000)
-                return prg[prgBankAddr(prg, b6, off)];
-            else
-                return prg[prgBankAddr(prg, last, off)];
-        }
+        // Reads usually allowed even if writes are disabled; RAM smaller than
+        // 8 KiB (NES 2.0, e.g. MMC6's 1 KiB) mirrors through the window
+        return prgRAM[(a - 0x6000) % prgRAM.size()];
     }
+    if (a >= 0x8000) return prgSlot[(a >> 13) & 3][a & 0x1FFF];
     return 0xFF;
 }
 
+const uint8_t* MapperMMC3::cpuReadPage(uint16_t a) {
+    a &= 0xFF00;
+    if (a >= 0x6000 && a < 0x8000) {
+        const size_t off = (a - 0x6000) % prgRAM.size();
+        return off + 0x100 <= prgRAM.size() ? &prgRAM[off] : nullptr;
+    }
+    if (a < 0x8000) return nullptr;
+    return prgSlot[(a >> 13) & 3] + (a & 0x1FFF);
+}
+
 void MapperMMC3::cpuWrite(uint16_t a, uint8_t v) {
     if (a >= 0x6000 && a < 0x8000) {
         // Write only if enabled (bit7=1) and not write-protected (bit6=0)
         if ((prgRAMEnable & 0x80) && ((prgRAMEnable & 0x40) == 0))
-            prgRAM[a - 0x6000] = v;
+            prgRAM[(a - 0x6000) % prgRAM.size()] = v;
         return;
     }
     if (a < 0x8000) return;
@@ -67,12 +96,14 @@ void MapperMMC3::cpuWrite(uint16_t a, uint8_t v) {
             bankSelect = v & 0x07;
             prgMode = (v & 0x40) != 0;
             chrMode = (v & 0x80) != 0;
+            updateBanks();
             break;
         case 0x8001: {
             uint8_t idx = bankSelect & 7;
             uint8_t val = v;
             if (idx <= 1) val &= 0xFE;  // 2KB banks force even
             bank[idx] = val;
+            updateBanks();
         } break;
         case 0xA000:
             // 0 = vertical, 1 = horizontal (our PPU uses 0=horiz,1=vert)
@@ -97,93 +128,48 @@ void MapperMMC3::cpuWrite(uint16_t a, uint8_t v) {
     }
 }
 
-uint8_t MapperMMC3::ppuRead(uint16_t a) {
-    if (a >= 0x2000) return 0;
-
-    auto rd1k = [&](uint8_t b, uint32_t o) -> uint8_t {
-        return chr[((uint32_t)b * 0x0400u + (o & 0x03FFu)) % chr.size()];
+uint32_t MapperMMC3::chrOffset(uint16_t a) const {
+    auto at1k = [&](uint8_t b, uint32_t o) -> uint32_t {
+        return ((uint32_t)b * 0x0400u + (o & 0x03FFu)) % (uint32_t)chr.size();
     };
-    auto rd2k = [&](uint8_t bEven, uint32_t o) -> uint8_t {
+    auto at2k = [&](uint8_t bEven, uint32_t o) -> uint32_t {
         uint32_t base = (uint32_t)(bEven & 0xFE) * 0x0400u;
-        return chr[(base + (o & 0x07FFu)) % chr.size()];
+        return (base + (o & 0x07FFu)) % (uint32_t)chr.size();
     };
 
     if (!chrMode) {
         if (a < 0x0800)
-            return rd2k(bank[0], a & 0x07FF);
+            return at2k(bank[0], a & 0x07FF);
         else if (a < 0x1000)
-            return rd2k(bank[1], a & 0x07FF);
+            return at2k(bank[1], a & 0x07FF);
         uint8_t idx = 2 + ((a - 0x1000) >> 10);  // 2..5
-        return rd1k(bank[idx], a & 0x03FF);
+        return at1k(bank[idx], a & 0x03FF);
     } else {
         if (a < 0x1000) {
             uint8_t idx = 2 + (a >> 10);  // 2..5
-            return rd1k(bank[idx], a & 0x03FF);
+            return at1k(bank[idx], a & 0x03FF);
         }
         if (a < 0x1800)
-            return rd2k(bank[0], a & 0x07FF);
+            return at2k(bank[0], a & 0x07FF);
         else
-            return rd2k(bank[1], a & 0x07FF);
+            return at2k(bank[1], a & 0x07FF);
     }
 }
 
-void MapperMMC3::ppuWrite(uint16_t a, uint8_t v) {
-    if (a >= 0x2000 || !chrIsRAM) return;
-
-    auto wr1k = [&](uint8_t b, uint32_t o, uint8_t val) {
-        chr[((uint32_t)b * 0x0400u + (o & 0x03FFu)) % chr.size()] = val;
-    };
-    auto wr2k = [&](uint8_t bEven, uint32_t o, uint8_t val) {
-        uint32_t base = (uint32_t)(bEven & 0xFE) * 0x0400u;
-        chr[(base + (o & 0x07FFu)) % chr.size()] = val;
-    };
-
-    if (!chrMode) {
-        if (a < 0x0800)
-            wr2k(bank[0], a & 0x07FF, v);
-        else if (a < 0x1000)
-            wr2k(bank[1], a & 0x07FF, v);
-        else
-            wr1k(bank[2 + ((a - 0x1000) >> 10)], a & 0x03FF, v);
-    } else {
-        if (a < 0x1000)
-            wr1k(bank[2 + (a >> 10)], a & 0x03FF, v);
-        else if (a < 0x1800)
-            wr2k(bank[0], a & 0x07FF, v);
-        else
-            wr2k(bank[1], a & 0x07FF, v);
-    }
+uint8_t MapperMMC3::ppuRead(uint16_t a) {
+    if (a >= 0x2000) return 0;
+    return chrSlot[a >> 10][a & 0x03FF];
 }
 
-void MapperMMC3::ppuA12Clock(bool level) {
-    if (!level) {
-        if (a12LowCycles < 64) a12LowCycles++;
-    } else {
-        if (!prevA12) {                 // rising edge
-            if (a12LowCycles >= 8) {    // 8-dot filter
-                if (irqReload) { irqCounter = irqLatch; irqReload = false; }
-                else if (irqCounter == 0) irqCounter = irqLatch;
-                else irqCounter--;
-
-                if (irqCounter == 0 && irqEnable) irqFlag = true;
-                sawRiseThisLine = true;       // <-- mark it
-            }
-        }
-        a12LowCycles = 0;
-    }
-    prevA12 = level;
+void MapperMMC3::ppuWrite(uint16_t a, uint8_t v) {
+    if (a >= 0x2000 || !chrIsRAM) return;
+    const_cast<uint8_t*>(chrSlot[a >> 10])[a & 0x03FF] = v;  // into chrRAM
 }
 
-void MapperMMC3::ppuOnScanlineDot260(bool rendering) {
-    if (!rendering) { sawRiseThisLine = false; return; }  // reset when not rendering
+void MapperMMC3::ppuA12Rise() {
+    if (irqReload) { irqCounter = irqLatch; irqReload = false; }
+    else if (irqCounter == 0) irqCounter = irqLatch;
+    else irqCounter--;
 
-    // Only synthesize the clock if no valid edge happened this line
-    if (!sawRiseThisLine) {
-        if (irqReload) { irqCounter = irqLatch; irqReload = false; }
-        else if (irqCounter == 0) irqCounter = irqLatch;
-        else irqCounter--;
-
-        if (irqCounter == 0 && irqEnable) irqFlag = true;
-    }
-    sawRiseThisLine = false;  // prep for next line
+    if (irqCounter == 0 && irqEnable) irqFlag = true;
 }
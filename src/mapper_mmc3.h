@@ -4,11 +4,13 @@
 #include <array>
 #include <vector>
 #include "mapper.h"
+#include "rom_image.h"
 
 struct MapperMMC3 : Mapper {
-    std::vector<uint8_t> prg, chr;
+    RomSpan prg, chr;             // chr is CHR-ROM, or chrRAM
+    std::vector<uint8_t> chrRAM;
     std::vector<uint8_t> prgRAM;  // $6000–7FFF
-    bool chrIsRAM = false;        // if true, chr[] is RAM
+    bool chrIsRAM = false;
     uint8_t mir = 0;
 
     uint8_t bankSelect = 0;
@@ -20,25 +22,28 @@ struct MapperMMC3 : Mapper {
     uint8_t irqLatch = 0, irqCounter = 0;
     bool irqEnable = false, irqReload = false, irqFlag = false;
 
-    // A12 low-time filter (12 PPU cycles)
-    bool prevA12 = false;
-    int a12LowCycles = 0;
-    bool sawRiseThisLine = false;
+    // Banks resolved to host pointers: 8 KiB PRG slots at $8000/$A000/$C000/$E000,
+    // 1 KiB CHR slots at $0000-$1C00. Rebuilt by updateBanks() on $8000/$8001 writes.
+    const uint8_t* prgSlot[4] = {};
+    const uint8_t* chrSlot[8] = {};
 
-
-    MapperMMC3(std::vector<uint8_t> prg_, std::vector<uint8_t> chr_, uint8_t mir_, uint32_t prgRamKB);
+    // CHR-RAM of chrRamKB (8 if 0) when `chr_` is empty
+    MapperMMC3(RomSpan prg_, RomSpan chr_, uint32_t chrRamKB, uint8_t mir_, uint32_t prgRamKB);
 
     uint8_t cpuRead(uint16_t a) override;
     void cpuWrite(uint16_t a, uint8_t v) override;
     uint8_t ppuRead(uint16_t a) override;
     void ppuWrite(uint16_t a, uint8_t v) override;
     uint8_t mirroring() const override { return mir; }
+    const uint8_t* cpuReadPage(uint16_t a) override;
+    void updateBanks();
+    uint32_t prgOffset(uint16_t a) const;  // index into prg for a >= $8000
+    uint32_t chrOffset(uint16_t a) const;  // index into chr for a < $2000
 
     // IRQ hooks
     bool irqPending() const override { return irqFlag; }
     void irqAck() override { irqFlag = false; }
-    void ppuA12Clock(bool level) override;
-    void ppuOnScanlineDot260(bool rendering) override;
+    void ppuA12Rise() override;
 
     // Save surface
     uint8_t* prgRamData() override { return prgRAM.data(); }
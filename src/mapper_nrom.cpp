@@ -1,18 +1,39 @@
 // mapper_nrom.cpp
 #include "mapper_nrom.h"
 
+// NROM-128: 16KB PRG, mirror 0x8000-0xBFFF to 0xC000-0xFFFF
+// NROM-256: 32KB PRG, no mirroring
+static uint32_t prgOffset(size_t prgSize, uint16_t addr) {
+    return (prgSize == 0x4000) ? ((addr - 0x8000) & 0x3FFF) : (addr - 0x8000);
+}
+
+MapperNROM::MapperNROM(RomSpan prg_, RomSpan chr_, uint32_t chrRamKB, uint8_t mir_)
+    : prg(prg_), chr(chr_), hasChrRam(chr_.empty()), mir(mir_) {
+    if (hasChrRam) {
+        chrRAM.assign((chrRamKB ? chrRamKB : 8) * 1024, 0);
+        chr = chrRAM;
+    }
+    updateBanks();
+}
+
+void MapperNROM::updateBanks() {
+    for (int s = 0; s < 4; ++s) {
+        uint32_t prgAddr = prgOffset(prg.size(), (uint16_t)(0x8000 + s * 0x2000));
+        prgSlot[s] = (prgAddr + 0x2000 <= prg.size()) ? &prg[prgAddr] : nullptr;
+    }
+}
+
 uint8_t MapperNROM::cpuRead(uint16_t addr) {
     // Only respond to addresses in 0x8000-0xFFFF
     if (addr < 0x8000) return 0xFF;
 
-    size_t prgSize = prg.size();
-    // NROM-128: 16KB PRG, mirror 0x8000-0xBFFF to 0xC000-0xFFFF
-    // NROM-256: 32KB PRG, no mirroring
-    uint32_t prgAddr = (prgSize == 0x4000) ? ((addr - 0x8000) & 0x3FFF) : (addr - 0x8000);
+    const uint8_t* slot = prgSlot[(addr >> 13) & 3];
+    return slot ? slot[addr & 0x1FFF] : 0xFF;
+}
 
-    if (prgAddr < prgSize)
-        return prg[prgAddr];
-    return 0xFF;
+const uint8_t* MapperNROM::cpuReadPage(uint16_t addr) {
+    if (addr < 0x8000 || !prgSlot[(addr >> 13) & 3]) return nullptr;
+    return prgSlot[(addr >> 13) & 3] + (addr & 0x1F00);
 }
 
 void MapperNROM::cpuWrite(uint16_t, uint8_t) {
@@ -28,6 +49,6 @@ uint8_t MapperNROM::ppuRead(uint16_t addr) {
 
 void MapperNROM::ppuWrite(uint16_t addr, uint8_t value) {
     // Only allow writes if CHR RAM is present
-    if (addr < 0x2000 && hasChrRam && addr < chr.size())
-        chr[addr] = value;
+    if (addr < 0x2000 && hasChrRam && addr < chrRAM.size())
+        chrRAM[addr] = value;
 }
@@ -2,17 +2,23 @@
 #pragma once
 #include <vector>
 #include "mapper.h"
+#include "rom_image.h"
 
 struct MapperNROM : Mapper {
-    std::vector<uint8_t> prg, chr;
+    RomSpan prg, chr;              // chr is CHR-ROM, or chrRAM
+    std::vector<uint8_t> chrRAM;
     bool hasChrRam=false;
     uint8_t mir=0;
+    // 8 KiB PRG slots at $8000/$A000/$C000/$E000 (NROM-128 mirrored); null past the ROM
+    const uint8_t* prgSlot[4] = {};
 
-    MapperNROM(std::vector<uint8_t> prg_, std::vector<uint8_t> chr_, bool chrRam, uint8_t mir_)
-      : prg(std::move(prg_)), chr(std::move(chr_)), hasChrRam(chrRam), mir(mir_) {}
+    // CHR-RAM of chrRamKB (8 if 0) when `chr_` is empty
+    MapperNROM(RomSpan prg_, RomSpan chr_, uint32_t chrRamKB, uint8_t mir_);
+    void updateBanks();
 
     uint8_t cpuRead(uint16_t a) override;
     void    cpuWrite(uint16_t a, uint8_t v) override;
+    const uint8_t* cpuReadPage(uint16_t a) override;
     uint8_t ppuRead(uint16_t a) override;
     void    ppuWrite(uint16_t a, uint8_t v) override;
     uint8_t mirroring() const override { return mir; }
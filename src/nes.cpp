@@ -3,6 +3,8 @@
 
 #include <SDL2/SDL.h>
 
+#include <algorithm>
+
 #include "apu.h"
 #include "bus.h"
 #include "cartridge.h"
@@ -16,6 +18,7 @@ bool NES::loadROM(const std::string& path) {
 }
 
 void NES::powerOn() {
+    audio.reset();
     bus = std::make_unique<Bus>();
     cpu = std::make_unique<CPU>();
     ppu = std::make_unique<PPU>();
@@ -33,44 +36,124 @@ void NES::powerOn() {
     // Initialize OAM to 0xFF per power-on expectations
     std::memset(ppu->oam, 0xFF, sizeof(ppu->oam));
 
+    if (audioOnly) {
+        ppu->timingOnly = true;
+        apu->capture = audioOnly;
+    }
+    if (silent) {
+        apu->mode = APU::Mode::Track;  // CPU-visible state only; no worker takes the log
+    } else if (threadedAudio && !audioOnly) {
+        audio = std::make_unique<AudioWorker>();
+        apu->mode = APU::Mode::Track;
+        apu->worker = audio.get();
+        audio->start();
+    }
     apu->init();
     apu->bus = bus.get();
+    scheduler.reset();
+    apu->sched = &scheduler;
+    apu->resetFrameSequencer(/*fiveStep=*/false, /*inhibitIRQ=*/false, /*immediateClock=*/false);
 
     cpu->reset();
 }
 
-void NES::runFrame() {
+void NES::runFrame(bool compose) {
     input->poll();
+    ppu->composeFrame = compose;
     bool frameDone = false;
     while (!frameDone) {
-        // CPU executes one instruction (or 1 DMA-stall cycle)
+        if (cpu->dma_stall_cycles) {
+            frameDone = idleDmaStall();
+            continue;
+        }
+
+        // CPU executes one instruction
         int cpuCycles = cpu->step();
 
-        // APU ticks once per CPU cycle
-        for (int i = 0; i < cpuCycles; i++) {
-            apu->tickCPU();
+        // Advance the master clock; the APU catches up lazily from its events
+        scheduler.now += (uint64_t)cpuCycles;
+        Scheduler::Event ev;
+        uint64_t at;
+        while (scheduler.popDue(ev, at)) dispatch(ev, at);
+
+        frameDone = clockPPU(cpuCycles);
+    }
+    apu->endFrame();
+}
+
+// OAM DMA: the CPU does nothing for 513/514 cycles, so run the PPU through
+// them without stepping it, up to the next scheduled event or the end of the
+// frame.
+bool NES::idleDmaStall() {
+    const int n = (int)std::min<uint64_t>((uint64_t)cpu->dma_stall_cycles, std::max<uint64_t>(scheduler.untilNext(), 1));
+    int k = 0;
+    bool frameDone = false;
+    while (k < n && !frameDone) {
+        frameDone = clockPPU(1);
+        ++k;
+    }
+    cpu->dma_stall_cycles -= k;
+    cpu->cycles += (uint64_t)k;
+
+    scheduler.now += (uint64_t)k;
+    Scheduler::Event ev;
+    uint64_t at;
+    while (scheduler.popDue(ev, at)) dispatch(ev, at);
+    return frameDone;
+}
+
+bool NES::clockPPU(int cpuCycles) {
+    bool frameDone = false;
+    if (ppu->timingOnly) {
+        // Audio-only: nothing between the PPU's timing points needs single dots
+        frameDone = ppu->runTiming(cpuCycles * 3);
+        bool nmiLevel = (ppu->nmi_occurred && ppu->nmi_output());
+        if (nmiLevel && !nmiLinePrev) cpu->nmi();
+        nmiLinePrev = nmiLevel;
+        return frameDone;
+    }
+
+    // PPU runs 3x per CPU cycle
+    for (int i = 0; i < cpuCycles * 3; i++) {
+        ppu->tick();
+
+        // PPU can request NMI at start of vblank
+        bool nmiLevel = (ppu->nmi_occurred && ppu->nmi_output());
+        if (nmiLevel && !nmiLinePrev) {
+            cpu->nmi();  // post NMI edge
         }
+        nmiLinePrev = nmiLevel;
 
-        // PPU runs 3x per CPU cycle
-        for (int i = 0; i < cpuCycles * 3; i++) {
-            ppu->tick();
-
-            // PPU can request NMI at start of vblank
-            bool nmiLevel = (ppu->nmi_occurred && ppu->nmi_output());
-            if (nmiLevel && !nmiLinePrev) {
-                cpu->nmi();  // post NMI edge
-            }
-            nmiLinePrev = nmiLevel;
-
-            // We define a frame boundary when we wrap back to (0,0)
-            if (ppu->scanline == 0 && ppu->dot == 0) {
-                frameDone = true;
-            }
+        // We define a frame boundary when we wrap back to (0,0)
+        if (ppu->scanline == 0 && ppu->dot == 0) {
+            frameDone = true;
         }
     }
+    return frameDone;
+}
+
+void NES::dispatch(Scheduler::Event e, uint64_t at) {
+    switch (e) {
+        case Scheduler::ApuFrameSequencer:
+            apu->frameSequencerEvent(at);
+            break;
+        case Scheduler::ApuDmc:
+            apu->dmcEvent(at);
+            break;
+        case Scheduler::EventCount:
+            break;
+    }
+}
+
+void NES::stopAudio() {
+    audio.reset();
+    if (apu) {
+        apu->worker = nullptr;
+        apu->shutdown();
+    }
 }
 
 NES::~NES() {
-    if (apu) apu->shutdown();
+    stopAudio();
     if (cart) cart->saveSave();
 }
@@ -6,9 +6,11 @@
 #include "cpu.h"
 #include "ppu.h"
 #include "apu.h"
+#include "audio_worker.h"
 #include "bus.h"
 #include "input.h"
 #include "cartridge.h"
+#include "scheduler.h"
 
 struct NES {
     std::unique_ptr<CPU>  cpu;
@@ -17,9 +19,19 @@ struct NES {
     std::unique_ptr<Bus>  bus;
     std::unique_ptr<Input> input;
     std::shared_ptr<Cartridge> cart;
+    Scheduler scheduler;  // master clock in CPU cycles
+    std::unique_ptr<AudioWorker> audio;  // set when synthesis runs on its own thread
+    bool threadedAudio = false;          // applied at powerOn
+    const AudioCapture* audioOnly = nullptr;  // applied at powerOn: PPU timing only, audio to capture
+    bool silent = false;                      // applied at powerOn: no audio device or synthesis (previews)
     bool nmiLinePrev = false; 
     bool loadROM(const std::string& path);
     void powerOn();
-    void runFrame();
+    void runFrame(bool compose = true);  // compose=false: frameskip (no pixel output)
+    void dispatch(Scheduler::Event e, uint64_t at);
+    bool clockPPU(int cpuCycles);  // true if a frame started
+    bool idleDmaStall();           // true if a frame started
+    APU* audioOutput() { return audio ? &audio->apu : apu.get(); }  // owns the device / stats
+    void stopAudio();
     ~NES();
 };
@@ -0,0 +1,230 @@
+// ntsc_filter.cpp
+#include "ntsc_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "cpu_features.h"
+#include "ppu.h"
+#include "thread_pool.h"
+
+#ifdef NES_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr int kGroups = NtscFilter::kOutWidth / 7;  // 86; the last one holds input pixel 255 only
+constexpr int kPadLeft = 2;                         // taps reach back to 3g-2
+constexpr int kLineColors = 3 * (kGroups - 1) + 7;  // last group's taps
+constexpr int kFracBits = 5;
+constexpr uint16_t kBlankColor = 0x0F;  // black, no emphasis: decodes to nothing
+
+using Kernel = NtscFilter::Kernel;
+
+// ===== 2C02 composite signal (nesdev "NTSC video") =====
+constexpr double kLevels[8] = {0.228, 0.312, 0.552, 0.880,   // low
+                               0.616, 0.840, 1.100, 1.100};  // high
+constexpr double kBlack = 0.312, kWhite = 1.100;
+constexpr double kAttenuation = 0.746;  // per emphasized phase range
+
+bool inColorPhase(int hue, int phase) { return (hue + phase) % 12 < 6; }
+
+// `color`: emphasis << 6 | index; `phase`: 0..11. Normalized so that black is 0, white 1.
+double signal(int color, int phase) {
+    const int hue = color & 0x0F;
+    int level = (color >> 4) & 3;
+    const int emphasis = color >> 6;
+    if (hue > 13) level = 1;
+    double lo = kLevels[level], hi = kLevels[4 + level];
+    if (hue == 0) lo = hi;
+    if (hue > 12) hi = lo;
+    double v = inColorPhase(hue, phase) ? hi : lo;
+    if (((emphasis & 1) && inColorPhase(0, phase)) || ((emphasis & 2) && inColorPhase(4, phase)) ||
+        ((emphasis & 4) && inColorPhase(8, phase)))
+        v *= kAttenuation;
+    return (v - kBlack) / (kWhite - kBlack);
+}
+
+// ===== Decoder =====
+// Boxes of exactly one (luma) and two (chroma) color cycles, integrated over
+// each phase sample, cancel the subcarrier in flat areas at any output position.
+constexpr double kLumaRadius = 6.0, kChromaRadius = 12.0;  // in phases
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kHue = 105.0 * kPi / 180.0;  // fitted to PPU::kNesPalette
+constexpr double kSaturation = 0.8;
+
+double boxWeight(double s, double center, double radius) {
+    return std::max(0.0, std::min(s + 1.0, center + radius) - std::max(s, center - radius));
+}
+
+// ===== Line kernels =====
+// colors[3g + t] is the input pixel 3g - 2 + t
+void lineScalar(const uint16_t* colors, const Kernel* k, uint32_t alpha, uint32_t* out) {
+    for (int g = 0; g < kGroups; ++g) {
+        int acc[8][4] = {};
+        for (int t = 0; t < 7; ++t) {
+            const Kernel& kk = k[t * 512 + colors[3 * g + t]];
+            for (int o = 0; o < 8; ++o)
+                for (int c = 0; c < 4; ++c) acc[o][c] += kk.v[o][c];
+        }
+        for (int o = 0; o < 7; ++o) {
+            uint32_t px = alpha;
+            for (int c = 0; c < 4; ++c) {
+                int v = std::min(255, std::max(0, (int)(int16_t)acc[o][c] >> kFracBits));
+                px |= (uint32_t)v << (8 * c);
+            }
+            out[7 * g + o] = px;
+        }
+    }
+}
+
+#ifdef NES_X86
+NES_TARGET_SSE2 void lineSSE2(const uint16_t* colors, const Kernel* k, uint32_t alpha, uint32_t* out) {
+    const __m128i a = _mm_set1_epi32((int)alpha);
+    uint32_t tail[8];
+    for (int g = 0; g < kGroups; ++g) {
+        __m128i acc0 = _mm_setzero_si128(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+        for (int t = 0; t < 7; ++t) {
+            const __m128i* kk = reinterpret_cast<const __m128i*>(k[t * 512 + colors[3 * g + t]].v);
+            acc0 = _mm_add_epi16(acc0, _mm_load_si128(kk + 0));
+            acc1 = _mm_add_epi16(acc1, _mm_load_si128(kk + 1));
+            acc2 = _mm_add_epi16(acc2, _mm_load_si128(kk + 2));
+            acc3 = _mm_add_epi16(acc3, _mm_load_si128(kk + 3));
+        }
+        __m128i lo = _mm_or_si128(_mm_packus_epi16(_mm_srai_epi16(acc0, kFracBits), _mm_srai_epi16(acc1, kFracBits)), a);
+        __m128i hi = _mm_or_si128(_mm_packus_epi16(_mm_srai_epi16(acc2, kFracBits), _mm_srai_epi16(acc3, kFracBits)), a);
+        // 8 pixels per store; pixel 7 is the next group's first and gets overwritten
+        uint32_t* o = (g + 1 < kGroups) ? out + 7 * g : tail;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(o), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(o + 4), hi);
+    }
+    std::memcpy(out + 7 * (kGroups - 1), tail, 7 * sizeof(uint32_t));
+}
+
+NES_TARGET_AVX2 void lineAVX2(const uint16_t* colors, const Kernel* k, uint32_t alpha, uint32_t* out) {
+    const __m256i a = _mm256_set1_epi32((int)alpha);
+    uint32_t tail[8];
+    for (int g = 0; g < kGroups; ++g) {
+        __m256i acc0 = _mm256_setzero_si256(), acc1 = acc0;
+        for (int t = 0; t < 7; ++t) {
+            const __m256i* kk = reinterpret_cast<const __m256i*>(k[t * 512 + colors[3 * g + t]].v);
+            acc0 = _mm256_add_epi16(acc0, _mm256_load_si256(kk + 0));
+            acc1 = _mm256_add_epi16(acc1, _mm256_load_si256(kk + 1));
+        }
+        // PACKUS interleaves the lanes of acc0 and acc1; put the 8 pixels back in order
+        __m256i px = _mm256_packus_epi16(_mm256_srai_epi16(acc0, kFracBits), _mm256_srai_epi16(acc1, kFracBits));
+        px = _mm256_or_si256(_mm256_permute4x64_epi64(px, 0xD8), a);
+        uint32_t* o = (g + 1 < kGroups) ? out + 7 * g : tail;
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(o), px);
+    }
+    std::memcpy(out + 7 * (kGroups - 1), tail, 7 * sizeof(uint32_t));
+}
+#endif
+
+}  // namespace
+
+NtscFilter::Isa NtscFilter::bestIsa() {
+    const CpuFeatures& f = cpuFeatures();
+    if (f.avx2) return Isa::AVX2;
+    if (f.sse2) return Isa::SSE2;
+    return Isa::Scalar;
+}
+
+const char* NtscFilter::isaName(Isa isa) {
+    switch (isa) {
+        case Isa::AVX2:
+            return "AVX2";
+        case Isa::SSE2:
+            return "SSE2";
+        default:
+            return "scalar";
+    }
+}
+
+NtscFilter::NtscFilter(Palette::Layout layout) : kernels((size_t)kPhases * kTaps * kColors) {
+    static_assert(kTaps == 7 && kColors == 512, "line kernels hard-code the table shape");
+    alpha = 0xFFu << layout.a;
+    const int lane[3] = {layout.r / 8, layout.g / 8, layout.b / 8};
+
+    for (int p = 0; p < kPhases; ++p) {
+        // Phase samples s of a group (input pixel 3g + s/8), relative to its first
+        std::vector<double> rgb((size_t)kTaps * kColors * 7 * 3);
+        for (int q = 0; q < 7; ++q) {
+            const double center = (q + 0.5) * 24.0 / 7.0;
+            for (int s = -8 * 2; s < 8 * (kTaps - 2); ++s) {
+                const double wy = boxWeight(s, center, kLumaRadius) / (2 * kLumaRadius);
+                const double wc = boxWeight(s, center, kChromaRadius) / (2 * kChromaRadius);
+                if (wy == 0.0 && wc == 0.0) continue;
+                const int phase = ((s + 4 * p) % 12 + 12) % 12;
+                const int tap = (s + 16) / 8;
+                const double carrier = 2.0 * kPi * (phase + 0.5) / 12.0 + kHue;
+                const double ci = 2.0 * kSaturation * wc * std::cos(carrier);
+                const double cq = 2.0 * kSaturation * wc * std::sin(carrier);
+                for (int color = 0; color < kColors; ++color) {
+                    const double v = signal(color, phase);
+                    const double y = v * wy, i = v * ci, qq = v * cq;
+                    double* out = &rgb[(((size_t)tap * kColors + color) * 7 + q) * 3];
+                    out[0] += y + 0.956 * i + 0.621 * qq;
+                    out[1] += y - 0.272 * i - 0.647 * qq;
+                    out[2] += y - 1.107 * i + 1.705 * qq;
+                }
+            }
+        }
+        for (int t = 0; t < kTaps; ++t) {
+            for (int color = 0; color < kColors; ++color) {
+                Kernel& k = kernels[((size_t)p * kTaps + t) * kColors + color];
+                std::memset(&k, 0, sizeof(k));
+                for (int q = 0; q < 7; ++q) {
+                    for (int c = 0; c < 3; ++c)
+                        k.v[q][lane[c]] = (int16_t)std::lround(rgb[(((size_t)t * kColors + color) * 7 + q) * 3 + c] *
+                                                               255.0 * (1 << kFracBits));
+                    if (t == 0)  // every group sums exactly one tap-0 kernel: round there
+                        for (int c = 0; c < 4; ++c) k.v[q][c] += 1 << (kFracBits - 1);
+                }
+            }
+        }
+    }
+    forceIsa(bestIsa());
+}
+
+void NtscFilter::forceIsa(Isa isa) {
+    const CpuFeatures& f = cpuFeatures();
+    if (isa == Isa::AVX2 && !f.avx2) isa = Isa::SSE2;
+    if (isa == Isa::SSE2 && !f.sse2) isa = Isa::Scalar;
+    active = isa;
+    lineFn = &lineScalar;
+#ifdef NES_X86
+    if (isa == Isa::SSE2) lineFn = &lineSSE2;
+    if (isa == Isa::AVX2) lineFn = &lineAVX2;
+#endif
+}
+
+void NtscFilter::renderLine(const uint8_t* idx, uint8_t emphasis, uint64_t frameNo, int y, uint32_t* out) const {
+    uint16_t colors[kLineColors];
+    std::fill(colors, colors + kLineColors, kBlankColor);
+    const uint16_t e = (uint16_t)((emphasis & 7) << 6);
+    for (int x = 0; x < PPU::WIDTH; ++x) colors[kPadLeft + x] = (uint16_t)(e | (idx[x] & 0x3F));
+    // The line starts 4 phases later than the previous one (341 dots * 8 = 2728);
+    // with the odd-frame dot skip, frames alternate between two starting phases
+    const int phase = (int)((frameNo & 1) + (uint64_t)y) % kPhases;
+    lineFn(colors, &kernels[(size_t)phase * kTaps * kColors], alpha, out);
+}
+
+void NtscFilter::renderFrame(const uint8_t* idx, const uint8_t* emphasis, uint64_t frameNo, void* out, int pitch,
+                             ThreadPool* pool) const {
+    constexpr int kBandLines = 16;
+    constexpr int kBands = (PPU::HEIGHT + kBandLines - 1) / kBandLines;
+    auto band = [&](int b) {
+        const int y1 = std::min(PPU::HEIGHT, (b + 1) * kBandLines);
+        for (int y = b * kBandLines; y < y1; ++y)
+            renderLine(idx + y * PPU::WIDTH, emphasis[y], frameNo, y,
+                       reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(out) + (size_t)y * pitch));
+    };
+    if (pool) {
+        pool->run(kBands, band);
+    } else {
+        for (int b = 0; b < kBands; ++b) band(b);
+    }
+}
@@ -0,0 +1,61 @@
+// ntsc_filter.h
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "palette.h"
+
+struct ThreadPool;
+
+// NTSC composite video from the PPU's palette indices. The 2C02 signal is
+// modelled as the square wave it really is: 12 subcarrier phases per color
+// cycle, 8 per pixel, luma levels per row of the palette, emphasis
+// attenuating a third of the cycle per bit, and a starting phase that moves
+// by 4 per line and alternates per frame (dot crawl). A TV-style decoder
+// (one color cycle of luma low-pass, two of chroma, I/Q demodulation) turns
+// it back into RGB, 7 output pixels per 3 input pixels. Flat areas decode to
+// within a few levels of PPU::kNesPalette; edges get composite fringing and
+// crawl.
+//
+// The decoder is linear, so what an input pixel adds to each output pixel
+// only depends on its color, the line's phase and its place in its 3-pixel
+// group: those kernels are precomputed (as in blargg's nes_ntsc) and a group
+// of 7 outputs is the sum of 7 of them, 8 16-bit RGBA lanes wide (SSE2 2,
+// AVX2 4 output pixels per add). Frames are split into bands of lines across
+// a ThreadPool.
+struct NtscFilter {
+    static constexpr int kOutWidth = 602;  // 86 groups of 7
+    enum class Isa { Scalar, SSE2, AVX2 };
+
+    static Isa bestIsa();
+    static const char* isaName(Isa isa);
+
+    explicit NtscFilter(Palette::Layout layout = Palette::Layout{});
+    void forceIsa(Isa isa);  // benchmarking; clamped to what the CPU has
+    Isa isa() const { return active; }
+
+    // One PPU line (256 indices, emphasis bits) to kOutWidth pixels. `frameNo`
+    // and `y` pick the subcarrier phase.
+    void renderLine(const uint8_t* idx, uint8_t emphasis, uint64_t frameNo, int y, uint32_t* out) const;
+    // A whole 256x240 frame; output rows are `pitch` bytes apart
+    void renderFrame(const uint8_t* idx, const uint8_t* emphasis, uint64_t frameNo, void* out, int pitch,
+                     ThreadPool* pool = nullptr) const;
+
+    // Group kernel: what one input pixel adds to the 7 outputs of a group
+    // (slot 7 is padding), in output byte order, 1/32 units
+    struct alignas(32) Kernel {
+        int16_t v[8][4];
+    };
+
+   private:
+    static constexpr int kPhases = 3;  // line start phase 0, 4 or 8
+    static constexpr int kTaps = 7;    // inputs 3g-2 .. 3g+4 reach group g
+    static constexpr int kColors = 512;
+
+    using LineFn = void (*)(const uint16_t* colors, const Kernel* k, uint32_t alpha, uint32_t* out);
+
+    std::vector<Kernel> kernels;  // [phase][tap][color]
+    uint32_t alpha = 0;           // OR-ed into every output pixel
+    Isa active = Isa::Scalar;
+    LineFn lineFn = nullptr;
+};
@@ -0,0 +1,156 @@
+// palette.cpp
+#include "palette.h"
+
+#include "cpu_features.h"
+#include "ppu.h"
+
+#ifdef NES_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using Planes = uint8_t[4][4][16];
+
+// ===== Line expansion =====
+void expandScalar(const uint8_t* idx, const Planes&, const uint32_t* colors, uint32_t* out, int width) {
+    for (int x = 0; x < width; ++x) out[x] = colors[idx[x] & 0x3F];
+}
+
+#ifdef NES_X86
+// 16 indices -> 16 pixel words: per byte plane, one PSHUFB per quarter
+// (PSHUFB only looks at bits 0-3 here), then the planes are interleaved
+NES_TARGET_SSE41 void expandSSE41(const uint8_t* idx, const Planes& planes, const uint32_t*, uint32_t* out,
+                                  int width) {
+    const __m128i* t = reinterpret_cast<const __m128i*>(planes);
+    const __m128i m30 = _mm_set1_epi8(0x30), m10 = _mm_set1_epi8(0x10), m20 = _mm_set1_epi8(0x20);
+    for (int x = 0; x < width; x += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(idx + x));
+        const __m128i quarter = _mm_and_si128(v, m30);
+        const __m128i q1 = _mm_cmpeq_epi8(quarter, m10);
+        const __m128i q2 = _mm_cmpeq_epi8(quarter, m20);
+        const __m128i q3 = _mm_cmpeq_epi8(quarter, m30);
+        __m128i plane[4];
+        for (int b = 0; b < 4; ++b) {
+            const __m128i* tb = t + 4 * b;
+            __m128i r = _mm_shuffle_epi8(_mm_load_si128(tb + 0), v);
+            r = _mm_blendv_epi8(r, _mm_shuffle_epi8(_mm_load_si128(tb + 1), v), q1);
+            r = _mm_blendv_epi8(r, _mm_shuffle_epi8(_mm_load_si128(tb + 2), v), q2);
+            plane[b] = _mm_blendv_epi8(r, _mm_shuffle_epi8(_mm_load_si128(tb + 3), v), q3);
+        }
+        const __m128i lo01 = _mm_unpacklo_epi8(plane[0], plane[1]), hi01 = _mm_unpackhi_epi8(plane[0], plane[1]);
+        const __m128i lo23 = _mm_unpacklo_epi8(plane[2], plane[3]), hi23 = _mm_unpackhi_epi8(plane[2], plane[3]);
+        __m128i* o = reinterpret_cast<__m128i*>(out + x);
+        _mm_storeu_si128(o + 0, _mm_unpacklo_epi16(lo01, lo23));
+        _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(lo01, lo23));
+        _mm_storeu_si128(o + 2, _mm_unpacklo_epi16(hi01, hi23));
+        _mm_storeu_si128(o + 3, _mm_unpackhi_epi16(hi01, hi23));
+    }
+}
+
+NES_TARGET_AVX2 void expandAVX2(const uint8_t* idx, const Planes& planes, const uint32_t*, uint32_t* out,
+                                int width) {
+    __m256i t[16];  // plane quarters, broadcast to both lanes
+    const __m128i* src = reinterpret_cast<const __m128i*>(planes);
+    for (int i = 0; i < 16; ++i) t[i] = _mm256_broadcastsi128_si256(_mm_load_si128(src + i));
+    const __m256i m30 = _mm256_set1_epi8(0x30), m10 = _mm256_set1_epi8(0x10), m20 = _mm256_set1_epi8(0x20);
+    for (int x = 0; x < width; x += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + x));
+        const __m256i quarter = _mm256_and_si256(v, m30);
+        const __m256i q1 = _mm256_cmpeq_epi8(quarter, m10);
+        const __m256i q2 = _mm256_cmpeq_epi8(quarter, m20);
+        const __m256i q3 = _mm256_cmpeq_epi8(quarter, m30);
+        __m256i plane[4];
+        for (int b = 0; b < 4; ++b) {
+            const __m256i* tb = t + 4 * b;
+            __m256i r = _mm256_shuffle_epi8(tb[0], v);
+            r = _mm256_blendv_epi8(r, _mm256_shuffle_epi8(tb[1], v), q1);
+            r = _mm256_blendv_epi8(r, _mm256_shuffle_epi8(tb[2], v), q2);
+            plane[b] = _mm256_blendv_epi8(r, _mm256_shuffle_epi8(tb[3], v), q3);
+        }
+        // Unpacks work within 128-bit lanes: w0..w3 hold pixels 0-3|16-19, 4-7|20-23, 8-11|24-27, 12-15|28-31
+        const __m256i lo01 = _mm256_unpacklo_epi8(plane[0], plane[1]), hi01 = _mm256_unpackhi_epi8(plane[0], plane[1]);
+        const __m256i lo23 = _mm256_unpacklo_epi8(plane[2], plane[3]), hi23 = _mm256_unpackhi_epi8(plane[2], plane[3]);
+        const __m256i w0 = _mm256_unpacklo_epi16(lo01, lo23), w1 = _mm256_unpackhi_epi16(lo01, lo23);
+        const __m256i w2 = _mm256_unpacklo_epi16(hi01, hi23), w3 = _mm256_unpackhi_epi16(hi01, hi23);
+        __m256i* o = reinterpret_cast<__m256i*>(out + x);
+        _mm256_storeu_si256(o + 0, _mm256_permute2x128_si256(w0, w1, 0x20));
+        _mm256_storeu_si256(o + 1, _mm256_permute2x128_si256(w2, w3, 0x20));
+        _mm256_storeu_si256(o + 2, _mm256_permute2x128_si256(w0, w1, 0x31));
+        _mm256_storeu_si256(o + 3, _mm256_permute2x128_si256(w2, w3, 0x31));
+    }
+}
+#endif
+
+// ===== Emphasis =====
+// PPUMASK bits 5-7 (NTSC: red, green, blue) each darken the *other* two
+// channels; the $xE/$xF blacks are left alone.
+constexpr int kEmphasisAtten = 215;  // /256, ~0.84 per emphasized bit
+
+uint32_t emphasize(uint32_t argb, uint8_t index, int emphasis) {
+    if (!emphasis || (index & 0x0E) == 0x0E) return argb;
+    int ch[3] = {(int)(argb >> 16) & 0xFF, (int)(argb >> 8) & 0xFF, (int)argb & 0xFF};  // R, G, B
+    for (int bit = 0; bit < 3; ++bit) {
+        if (!(emphasis & (1 << bit))) continue;
+        for (int c = 0; c < 3; ++c)
+            if (c != bit) ch[c] = (ch[c] * kEmphasisAtten + 128) >> 8;
+    }
+    return (argb & 0xFF000000u) | (uint32_t)ch[0] << 16 | (uint32_t)ch[1] << 8 | (uint32_t)ch[2];
+}
+
+}  // namespace
+
+Palette::Isa Palette::bestIsa() {
+    const CpuFeatures& f = cpuFeatures();
+    if (f.avx2) return Isa::AVX2;
+    if (f.sse41) return Isa::SSE41;
+    return Isa::Scalar;
+}
+
+const char* Palette::isaName(Isa isa) {
+    switch (isa) {
+        case Isa::AVX2:
+            return "AVX2";
+        case Isa::SSE41:
+            return "SSE4.1";
+        default:
+            return "scalar";
+    }
+}
+
+const Palette& Palette::ntsc() {
+    static const Palette p(PPU::kNesPalette.data());
+    return p;
+}
+
+Palette::Palette(const uint32_t* argb64, Layout layout) {
+    for (int e = 0; e < 8; ++e) {
+        for (int i = 0; i < 64; ++i) {
+            uint32_t argb = emphasize(argb64[i], (uint8_t)i, e);
+            uint32_t c = (argb >> 24 & 0xFF) << layout.a | (argb >> 16 & 0xFF) << layout.r |
+                         (argb >> 8 & 0xFF) << layout.g | (argb & 0xFF) << layout.b;
+            table[e << 6 | i] = c;
+            for (int b = 0; b < 4; ++b) planes[e][b][i >> 4][i & 15] = (uint8_t)(c >> (8 * b));
+        }
+    }
+    forceIsa(bestIsa());
+}
+
+void Palette::forceIsa(Isa isa) {
+    const CpuFeatures& f = cpuFeatures();
+    if (isa == Isa::AVX2 && !f.avx2) isa = Isa::SSE41;
+    if (isa == Isa::SSE41 && !f.sse41) isa = Isa::Scalar;
+    active = isa;
+    lineFn = &expandScalar;
+#ifdef NES_X86
+    if (isa == Isa::SSE41) lineFn = &expandSSE41;
+    if (isa == Isa::AVX2) lineFn = &expandAVX2;
+#endif
+}
+
+void Palette::expandFrame(const uint8_t* idx, const uint8_t* emphasis, void* out, int pitch) const {
+    uint8_t* row = static_cast<uint8_t*>(out);
+    for (int y = 0; y < PPU::HEIGHT; ++y, row += pitch) {
+        expandLine(idx + y * PPU::WIDTH, emphasis[y], reinterpret_cast<uint32_t*>(row), PPU::WIDTH);
+    }
+}
@@ -0,0 +1,51 @@
+// palette.h
+#pragma once
+#include <cstdint>
+
+// Color output stage. The PPU emits 6-bit color indices per pixel and the
+// PPUMASK emphasis bits per scanline; 32-bit pixels are produced only where
+// they are needed, from a 512-entry table (emphasis << 6 | index), one
+// vectorized pass per line: a PSHUFB per 16-entry quarter of each byte plane
+// of the line's 64-color sub-table (SSE4.1 16, AVX2 32 pixels per step).
+struct Palette {
+    static constexpr int kEntries = 512;
+    enum class Isa { Scalar, SSE41, AVX2 };
+
+    static Isa bestIsa();
+    static const char* isaName(Isa isa);
+
+    // Bit position of each channel in an output pixel word; the default is
+    // ARGB8888. Formats without alpha get 0xFF in their unused byte.
+    struct Layout {
+        uint8_t r = 16, g = 8, b = 0, a = 24;
+    };
+
+    // The PPU's own colors (PPU::kNesPalette) with emphasis applied, ARGB8888
+    static const Palette& ntsc();
+
+    // `argb64`: the 64 colors without emphasis, ARGB8888
+    explicit Palette(const uint32_t* argb64) : Palette(argb64, Layout{}) {}
+    Palette(const uint32_t* argb64, Layout layout);
+    void forceIsa(Isa isa);  // benchmarking; clamped to what the CPU has
+    Isa isa() const { return active; }
+
+    uint32_t color(uint8_t emphasis, uint8_t index) const { return table[(emphasis & 7) << 6 | (index & 0x3F)]; }
+    const uint32_t* entries() const { return table; }
+
+    // Indices must be 0..63 (as the PPU writes them); `width` a multiple of 32
+    void expandLine(const uint8_t* idx, uint8_t emphasis, uint32_t* out, int width) const {
+        lineFn(idx, planes[emphasis & 7], table + ((emphasis & 7) << 6), out, width);
+    }
+    // A whole PPU frame (256x240); output rows are `pitch` bytes apart
+    void expandFrame(const uint8_t* idx, const uint8_t* emphasis, void* out, int pitch) const;
+
+   private:
+    using Planes = uint8_t[4][4][16];  // [byte of the pixel word][index >> 4][index & 15]
+    using LineFn = void (*)(const uint8_t* idx, const Planes& planes, const uint32_t* colors, uint32_t* out,
+                            int width);
+
+    uint32_t table[kEntries];
+    alignas(16) Planes planes[8];
+    Isa active = Isa::Scalar;
+    LineFn lineFn = nullptr;
+};
@@ -6,6 +6,7 @@
 #include <cstring>
 
 #include "cartridge.h"
+#include "compositor.h"
 #include "mapper.h"
 
 // --- NTSC palette (approx) ---
@@ -135,6 +136,7 @@ void PPU::cpuWriteRegister(uint16_t addr, uint8_t val) {
             break;
         case 4:
             oam[OAMADDR++] = val;
+            oamDirty = true;
             break;
         case 5:  // PPUSCROLL
             if (!addrLatch) {
@@ -163,11 +165,11 @@ void PPU::cpuWriteRegister(uint16_t addr, uint8_t val) {
     }
 }
 
-void PPU::oamDMA(const std::function<uint8_t(uint8_t)>& fetch256) {
+void PPU::oamDMA(const uint8_t* page) {
     uint8_t start = OAMADDR;  // hardware starts at OAMADDR and wraps
-    for (int i = 0; i < 256; ++i) {
-        oam[(uint8_t)(start + i)] = fetch256((uint8_t)i);
-    }
+    std::memcpy(&oam[start], page, 256 - start);
+    std::memcpy(oam, page + (256 - start), start);
+    oamDirty = true;
     // After DMA, OAMADDR is effectively unchanged (wrap of +256)
 }
 
@@ -184,13 +186,41 @@ void PPU::clearVBlank() {
     nmi_occurred = false;
 }
 
-void PPU::resetFrameState() {
-    std::memset(lineBG, 0, sizeof(lineBG));
-    std::memset(lineBGPix, 0, sizeof(lineBGPix));
-    std::memset(lineSPColIdx, 0, sizeof(lineSPColIdx));
-    std::memset(lineSPPix, 0, sizeof(lineSPPix));
-    std::memset(lineSPPrio, 0, sizeof(lineSPPrio));
-    std::memset(lineSP0Mask, 0, sizeof(lineSP0Mask));
+// Sprite row decoding: a pattern byte per plane becomes one byte per pixel,
+// leftmost pixel in the low byte; flipH reverses the plane bytes first.
+namespace {
+template <typename T>
+struct ByteTable {
+    T v[256];
+};
+
+constexpr ByteTable<uint8_t> makeBitReverse() {
+    ByteTable<uint8_t> t{};
+    for (int b = 0; b < 256; ++b)
+        for (int i = 0; i < 8; ++i)
+            if (b & (1 << i)) t.v[b] |= (uint8_t)(0x80 >> i);
+    return t;
+}
+constexpr ByteTable<uint64_t> makePlaneSpread() {
+    ByteTable<uint64_t> t{};
+    for (int b = 0; b < 256; ++b)
+        for (int c = 0; c < 8; ++c)
+            if (b & (0x80 >> c)) t.v[b] |= 1ull << (8 * c);
+    return t;
+}
+constexpr ByteTable<uint8_t> kBitReverse = makeBitReverse();
+constexpr ByteTable<uint64_t> kPlaneSpread = makePlaneSpread();
+static_assert(kBitReverse.v[0x01] == 0x80 && kBitReverse.v[0xC4] == 0x23, "bit reverse");
+static_assert(kPlaneSpread.v[0x81] == 0x0100000000000001ull, "pixel 0 is the pattern's bit 7");
+
+// kSpOpaque is bit 14 of each 16-bit lane: turn it into a full-lane mask
+constexpr uint64_t kLaneOpaque = 0x4000400040004000ull;
+inline uint64_t opaqueLanes(uint64_t w) { return ((w & kLaneOpaque) >> 14) * 0xFFFF; }
+}  // namespace
+
+static const Compositor& lineCompositor() {
+    static const Compositor c;
+    return c;
 }
 
 void PPU::startScanline() {
@@ -199,42 +229,29 @@ void PPU::startScanline() {
         PPUSTATUS &= ~0x40;  // clear sprite-0 hit
         PPUSTATUS &= ~0x20;  // clear sprite overflow
     }
-    resetFrameState();
     secCount = 0;
     std::memset(secOAM, 0xFF, sizeof(secOAM));
 }
 
 void PPU::endScanline() {
     if (scanline >= 0 && scanline < HEIGHT) {
-        const bool showBG = (PPUMASK & 0x08) != 0;
-        const bool showSP = (PPUMASK & 0x10) != 0;
-        const bool bgLeft8 = (PPUMASK & 0x02) != 0;
-        const bool spLeft8 = (PPUMASK & 0x04) != 0;
-
-        for (int x = 0; x < WIDTH; x++) {
-            bool bgMasked = (!bgLeft8 && x < 8);
-            bool spMasked = (!spLeft8 && x < 8);
-
-            uint8_t bgCol = (showBG && !bgMasked) ? lineBG[x] : universalIndex();
-            uint8_t bgRaw = (showBG && !bgMasked) ? lineBGPix[x] : 0;
-
-            uint8_t spCol = (showSP && !spMasked) ? lineSPColIdx[x] : 0;
-            uint8_t spRaw = (showSP && !spMasked) ? lineSPPix[x] : 0;
-            bool behind = lineSPPrio[x] != 0;
-
-            uint8_t out = bgCol;
-            if (spRaw && (!behind || bgRaw == 0)) {
-                out = spCol;
-            }
-            framebuffer[scanline * WIDTH + x] = kNesPalette[out];
-
-            // sprite-0 hit: requires nonzero raw BG+SP pixels, visible, obey left-8 masks
-            if (lineSP0Mask[x] && (bgRaw != 0) && (spRaw != 0)) {
-                bool bgLeftOK = bgLeft8 || (x >= 8);
-                bool spLeftOK = spLeft8 || (x >= 8);
-                if (showBG && showSP && bgLeftOK && spLeftOK) PPUSTATUS |= 0x40;
-            }
+        Compositor::LineState st;
+        st.universal = universalIndex();
+        st.showBG = (PPUMASK & 0x08) != 0;
+        st.showSP = (PPUMASK & 0x10) != 0;
+        st.bgLeft8 = (PPUMASK & 0x02) != 0;
+        st.spLeft8 = (PPUMASK & 0x04) != 0;
+
+        if (!composeFrame) {
+            // Skipped frame: only sprite-0 hit is observable by the CPU
+            if (!st.showBG || !st.showSP || (PPUSTATUS & 0x40)) return;
+            if (lineCompositor().spriteZeroHit(linePix, st)) PPUSTATUS |= 0x40;
+            return;
         }
+
+        // Priority, left-8 masks and sprite-0 hit for the whole line
+        lineEmphasis[scanline] = (uint8_t)(PPUMASK >> 5);
+        if (lineCompositor().compose(linePix, st, &frameIndex[scanline * WIDTH])) PPUSTATUS |= 0x40;
     }
 
     // Vertical increment/copies handled in tick() at exact dots
@@ -249,6 +266,21 @@ void PPU::evaluateSpritesWindow() {
     }
 
     int sprH = (PPUCTRL & 0x20) ? 16 : 8;
+    int found;
+    if (spriteEval == SpriteEval::Scan) {
+        found = scanSprites(sprH);
+    } else {
+        if (oamDirty || binnedHeight != sprH) rebuildSpriteBins(sprH);
+        found = binCount[scanline];
+        for (int n = 0; n < found; n++) std::memcpy(&secOAM[n * 4], &oam[bins[scanline][n] * 4], 4);
+    }
+    secCount = found;
+    if (found >= 8) {
+        PPUSTATUS |= 0x20;  // overflow (simplified)
+    }
+}
+
+int PPU::scanSprites(int sprH) {
     // One pass selection; overflow when >8
     int found = 0;
     for (int i = 0; i < 64 && found < 8; i++) {
@@ -260,10 +292,23 @@ void PPU::evaluateSpritesWindow() {
             found++;
         }
     }
-    secCount = found;
-    if (found >= 8) {
-        PPUSTATUS |= 0x20;  // overflow (simplified)
+    return found;
+}
+
+// OAM usually changes once per frame ($4014), so bucket every sprite into the
+// lines it covers once instead of testing all 64 on each of the 240 lines.
+// Walking OAM in order and capping each bin at 8 keeps the scan's selection.
+void PPU::rebuildSpriteBins(int sprH) {
+    std::memset(binCount, 0, sizeof(binCount));
+    for (int i = 0; i < 64; i++) {
+        const int top = (int)oam[i * 4 + 0] + 1;
+        const int bottom = std::min(top + sprH, (int)HEIGHT);
+        for (int line = top; line < bottom; line++) {
+            if (binCount[line] < 8) bins[line][binCount[line]++] = (uint8_t)i;
+        }
     }
+    oamDirty = false;
+    binnedHeight = sprH;
 }
 
 void PPU::renderSpritesForLine() {
@@ -272,11 +317,7 @@ void PPU::renderSpritesForLine() {
     const bool showSP = (PPUMASK & 0x10) != 0;
     const bool spLeft8 = (PPUMASK & 0x04) != 0;
 
-    std::memset(lineSPColIdx, 0, sizeof(lineSPColIdx));
-    std::memset(lineSPPix, 0, sizeof(lineSPPix));
-    std::memset(lineSPPrio, 0, sizeof(lineSPPrio));
-    std::memset(lineSP0Mask, 0, sizeof(lineSP0Mask));
-
+    // The BG pipeline left the sprite half of linePix clear at dots 1-256
     if (!showSP) return;
 
     int sprH = (PPUCTRL & 0x20) ? 16 : 8;
@@ -303,6 +344,13 @@ void PPU::renderSpritesForLine() {
         return {p0, p1};
     };
 
+    // Line words for the 3 opaque pixel values of each sprite palette
+    uint16_t spColor[4][4] = {};
+    for (int pal = 0; pal < 4; ++pal)
+        for (int pix = 1; pix < 4; ++pix)
+            spColor[pal][pix] =
+                (uint16_t)(((palette[0x10 + pal * 4 + pix] & 0x3F) << LinePixel::kSpColorShift) | LinePixel::kSpOpaque);
+
     for (int s = 0; s < secCount; ++s) {
         uint8_t y = secOAM[s * 4 + 0];
         uint8_t tile = secOAM[s * 4 + 1];
@@ -317,35 +365,61 @@ void PPU::renderSpritesForLine() {
         bool behind = (attr & 0x20) != 0;
         uint8_t pal = (attr & 0x03);
 
+        // Fetched even when transparent: the mapper sees every sprite's A12
         auto bits = fetchRow(tile, row, flipV);
         uint8_t p0 = bits.first, p1 = bits.second;
+        if ((p0 | p1) == 0) continue;
+        if (flipH) {
+            p0 = kBitReverse.v[p0];
+            p1 = kBitReverse.v[p1];
+        }
 
+        // 8 line words, left to right; transparent pixels stay 0
+        const uint64_t pix = kPlaneSpread.v[p0] | (kPlaneSpread.v[p1] << 1);
+        const uint16_t flags = (uint16_t)((behind ? LinePixel::kSpBehind : 0) | (s == 0 ? LinePixel::kSprite0 : 0));
+        uint16_t sp[8];
         for (int c = 0; c < 8; c++) {
-            int bit = flipH ? c : (7 - c);
-            int sx = x + c;
-            if (sx < 0 || sx >= WIDTH) continue;
-            if (!spLeft8 && sx < 8) continue;
-
-            uint8_t lo = (p0 >> bit) & 1;
-            uint8_t hi = (p1 >> bit) & 1;
-            uint8_t pix = (uint8_t)((hi << 1) | lo);
-            if (pix == 0) continue;       // transparent
-            if (lineSPPix[sx]) continue;  // OAM priority test must use *raw* spr pix, not color
-
-            uint8_t palIndex = (uint8_t)(0x10 + pal * 4 + pix);
-            if ((palIndex & 0x1F) == 0x10) palIndex = 0x00;  // $3F10 mirrors $3F00
-            uint8_t idx = palette[palIndex & 0x1F] & 0x3F;
-
-            lineSPPix[sx] = pix;     // <-- raw 1..3
-            lineSPColIdx[sx] = idx;  // final color index
-            lineSPPrio[sx] = behind ? 1 : 0;
-            if (s == 0) lineSP0Mask[sx] = 1;
+            const int v = (int)(pix >> (8 * c)) & 3;
+            sp[c] = v ? (uint16_t)(spColor[pal][v] | flags) : 0;
+        }
+        if (!spLeft8 && x < 8) std::memset(sp, 0, (size_t)(8 - x) * sizeof(uint16_t));
+
+        // Earlier sprites win (OAM priority on the raw sprite pixel, not the
+        // color): only lanes without kSpOpaque take this sprite's pixel.
+        // linePix has 8 spare entries for sprites past X=248.
+        for (int half = 0; half < 2; ++half) {
+            uint64_t line, spr;
+            std::memcpy(&line, &linePix[x + 4 * half], sizeof(line));
+            std::memcpy(&spr, &sp[4 * half], sizeof(spr));
+            line |= spr & ~opaqueLanes(line);
+            std::memcpy(&linePix[x + 4 * half], &line, sizeof(line));
         }
     }
 }
 
+// The mapper used to sample A12 on every dot and filter it itself: a rise
+// counts after 8+ dots low. Only BG pattern fetches at dots 1-256 drive A12
+// here, at most every other dot, so the filter reduces to a distance check
+// between fetches from $1000: the first one on each rendered line, or after
+// a mid-line switch to $1000.
+void PPU::a12High() {
+    if (a12Dots - a12LastHigh > 8) {
+        a12RoseThisLine = true;
+        if (cart && cart->mapper) cart->mapper->ppuA12Rise();
+    }
+    a12LastHigh = a12Dots;
+}
+
+// Lines 0-239: sprite fetches from $1000 raise A12 around dot 260; they are
+// not fetched dot by dot, so stand in for them when the BG didn't raise it
+void PPU::a12Dot260() {
+    const bool rise = renderingEnabled() && !a12RoseThisLine;
+    a12RoseThisLine = false;
+    if (rise && cart && cart->mapper) cart->mapper->ppuA12Rise();
+}
+
 void PPU::tick() {
-    a12ThisDot = false;  // reset for this PPU dot
+    ++a12Dots;
 
     // ----- BG pixel composition (sample first) -----
     if (scanline >= 0 && scanline < HEIGHT && dot >= 1 && dot <= 256) {
@@ -368,10 +442,9 @@ void PPU::tick() {
             if (!(PPUMASK & 0x02) && x < 8) bgPix = 0;  // left-8 BG mask
         }
 
-        lineBGPix[x] = bgPix;  // <-- raw 0..3
-                               // store the *final* BG color index too, for fast compositing when bgPix!=0
-        lineBG[x] = (bgPix == 0) ? universalIndex()
-                                 : (palette[(pal2 << 2) + bgPix] & 0x3F);
+        // Final BG color index plus the raw-pixel opacity; clears the sprite half for dot 257
+        linePix[x] = (bgPix == 0) ? universalIndex()
+                                  : (uint16_t)((palette[(pal2 << 2) + bgPix] & 0x3F) | LinePixel::kBgOpaque);
     }
 
     // reload the shifters for tile 0 only. Do NOT increment coarse X here.
@@ -404,13 +477,13 @@ if (renderingEnabled() && dot == 1) {
                 uint16_t p0 = patBase + ntLatch * 16 + fineY;
                 curChrAddr = p0;
                 patLoLatch = ppuRead(p0);
-                if (dot <= 256) a12ThisDot |= (p0 & 0x1000) != 0;
+                if (dot <= 256 && (p0 & 0x1000)) a12High();
             } break;
             case 7: /* PAT1 */ {
                 uint16_t p1 = patBase + ntLatch * 16 + fineY + 8;
                 curChrAddr = p1;
                 patHiLatch = ppuRead(p1);
-                if (dot <= 256) a12ThisDot |= (p1 & 0x1000) != 0;
+                if (dot <= 256 && (p1 & 0x1000)) a12High();
             } break;
             case 0: /* tile boundary */ {
                 // reload and THEN increment coarse X (this is for dots 8,16,24,...)
@@ -428,11 +501,7 @@ if (renderingEnabled() && dot == 1) {
         }
     }
 
-    if (scanline >= 0 && scanline < HEIGHT && dot == 260) {
-        if (cart && cart->mapper) {
-            cart->mapper->ppuOnScanlineDot260(renderingEnabled());
-        }
-    }
+    if (scanline >= 0 && scanline < HEIGHT && dot == 260) a12Dot260();
 
     // ----- Sprites (same coarse behavior) -----
     if (scanline >= 0 && scanline < HEIGHT) {
@@ -473,8 +542,6 @@ if (renderingEnabled() && dot == 1) {
     if (scanline == 261 && renderingEnabled()) {
         if (dot >= 280 && dot <= 304) copyVertical();
         if (frame_odd && dot == 339) {
-            // make sure the mapper sees a low (no CHR fetch) sample on this skipped dot
-            if (cart && cart->mapper) cart->mapper->ppuA12Clock(false);
             dot = 0;
             endScanline();
             scanline = 0;
@@ -500,9 +567,55 @@ if (renderingEnabled() && dot == 1) {
         }
         startScanline();
     }
+}
+
+// Audio-only runs keep just what the CPU and the mapper can observe: vblank
+// and NMI, the short odd frame, the MMC3 scanline clock at dot 260, and an
+// approximate sprite-0 hit (raised on sprite 0's first line whenever both
+// layers are on) so games that spin on $2002 keep going. Dots in between are
+// skipped in bulk; runTiming() does that inline until the next timing point.
+int PPU::nextTimingStop() const {
+    if (scanline < HEIGHT && dot < 260) return 260;
+    if (scanline == 241 && dot < 1) return 1;
+    if (scanline == 261 && dot < 339) return 339;
+    return 341;
+}
+
+bool PPU::runTimingEvents(int dots) {
+    bool frameStarted = false;
+    while (dots > 0) {
+        const bool rendering = renderingEnabled();
+        if (scanline < HEIGHT && dot == 260) a12Dot260();
+        if (scanline == 261 && dot == 339 && frame_odd && rendering) {
+            dot = 0;
+            scanline = 0;
+            frameStarted = true;
+            dots--;
+            continue;
+        }
+
+        int n = std::min(dots, nextTimingStop() - dot);
+        dot += n;
+        dots -= n;
 
-    // One A12 sample per PPU dot, based on last CHR fetch address.
-    if (cart && cart->mapper) {
-        cart->mapper->ppuA12Clock(a12ThisDot);
+        if (scanline == 241 && dot == 1) setVBlank();
+        if (dot > 340) {
+            dot = 0;
+            scanline++;
+            if (scanline > 261) {
+                scanline = 0;
+                frame_odd = !frame_odd;
+                frameStarted = true;
+            }
+            if (scanline == 261) {
+                clearVBlank();
+                PPUSTATUS &= ~0x60;  // sprite-0 hit, overflow
+            }
+            if (scanline == oam[0] + 1 && scanline < HEIGHT && (PPUMASK & 0x18) == 0x18) PPUSTATUS |= 0x40;
+        }
     }
+    // Sitting on dot 260 / 339 means that dot's work is still to do
+    const bool atEvent = (scanline < HEIGHT && dot == 260) || (scanline == 261 && dot == 339);
+    quietDots = atEvent ? 0 : nextTimingStop() - dot;
+    return frameStarted;
 }
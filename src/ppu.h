@@ -3,7 +3,6 @@
 #include <array>
 #include <cstdint>
 #include <cstring>
-#include <functional>
 
 struct Cartridge;
 
@@ -36,39 +35,52 @@ struct PPU {
     int scanline = 261;  // -1=>pre-render (we use 261)
     int dot = 0;         // 0..340
     bool frame_odd = false;
-    bool a12ThisDot = false;  // true if any CHR fetch (addr < $2000) with A12=1 happened this dot
 
     // NMI edge state
     bool nmi_output() const { return (PPUCTRL & 0x80) != 0; }
     bool nmi_occurred = false;
 
-    // Frame buffer (RGBA8888)
+    // Frame buffer: 6-bit color indices, plus the PPUMASK emphasis bits
+    // (bit 0 red, 1 green, 2 blue) each line was drawn with; see Palette
     static constexpr int WIDTH = 256, HEIGHT = 240;
-    uint32_t framebuffer[WIDTH * HEIGHT];
+    uint8_t frameIndex[WIDTH * HEIGHT];
+    uint8_t lineEmphasis[HEIGHT];
+    bool composeFrame = true;  // false = frameskip: keep sprite-0 timing, skip pixel output
+    bool timingOnly = false;   // audio-only runs: advance with runTiming() instead of tick()
 
-    // Per-scanline BG/SP staging (indices into kNesPalette)
-    uint8_t lineBG[WIDTH]{};
-    uint8_t lineSPColIdx[WIDTH]{};
-    uint8_t lineSPPrio[WIDTH]{};
-    uint8_t lineSP0Mask[WIDTH]{};
-    uint8_t lineBGPix[WIDTH]{};  // raw BG pixel value 0..3 (0 = transparent)
-    uint8_t lineSPPix[WIDTH]{};  // raw SPR pixel value 0..3 (0 = transparent)
+    // Sprite selection for each line. Binned sorts OAM into per-line lists in
+    // one pass, only after OAM or the sprite height changed; Scan tests all 64
+    // entries on every line. Both pick the same sprites and set the same flags.
+    enum class SpriteEval { Binned, Scan };
+    SpriteEval spriteEval = SpriteEval::Binned;
+
+    // Per-scanline BG/SP staging, one packed word per pixel (see LinePixel);
+    // sprites at X > 248 spill into the 8 entries past the line
+    uint16_t linePix[WIDTH + 8]{};
 
     // --- BG pipeline shifters (dot-exact) ---
     uint16_t bgShiftLo = 0, bgShiftHi = 0;
     uint16_t attrShiftLo = 0, attrShiftHi = 0;
     uint8_t ntLatch = 0, atLatch = 0, patLoLatch = 0, patHiLatch = 0;
-    uint16_t curChrAddr = 0;  // last CHR fetch addr (for mapper A12 clocking)
+    uint16_t curChrAddr = 0;  // last CHR fetch addr
 
     // Public API
     void connect(Cartridge* c) { cart = c; }
     uint8_t cpuReadRegister(uint16_t addr);
     void cpuWriteRegister(uint16_t addr, uint8_t v);
-    void oamDMA(const std::function<uint8_t(uint8_t)>& fetch256);
+    void oamDMA(const uint8_t* page);  // the 256 bytes of the source page
 
     // Ticking
-    void tick();             // advance 1 PPU dot
-    void resetFrameState();  // clear per-line buffers
+    void tick();  // advance 1 PPU dot
+    // timingOnly: advance several dots at once; true if a frame started
+    bool runTiming(int dots) {
+        if (dots < quietDots) {  // nothing observable happens in between
+            quietDots -= dots;
+            dot += dots;
+            return false;
+        }
+        return runTimingEvents(dots);
+    }
 
     // PPU memory
     uint8_t ppuRead(uint16_t addr);
@@ -78,6 +90,24 @@ struct PPU {
     static const std::array<uint32_t, 64> kNesPalette;
 
    private:
+    int quietDots = 0;  // timingOnly: dots until the next timing point
+
+    // A12 edges for the mapper (MMC3 IRQ counter)
+    uint64_t a12Dots = 0;          // dots since power-on
+    uint64_t a12LastHigh = 0;      // dot of the last BG pattern fetch from $1000
+    bool a12RoseThisLine = false;  // since the last dot 260
+    void a12High();
+    void a12Dot260();
+
+    // SpriteEval::Binned: the first 8 OAM entries covering each line, in OAM order
+    bool oamDirty = true;  // OAM written since the bins were built
+    int binnedHeight = 0;  // sprite height (8/16) the bins were built for
+    uint8_t binCount[HEIGHT]{};
+    uint8_t bins[HEIGHT][8]{};
+    void rebuildSpriteBins(int sprH);
+    bool runTimingEvents(int dots);
+    int nextTimingStop() const;
+
     // Nametable mirroring helpers
     uint8_t readNametable(uint16_t a);
     void writeNametable(uint16_t a, uint8_t v);
@@ -88,6 +118,7 @@ struct PPU {
 
     // BG & Sprite pipelines
     void evaluateSpritesWindow();  // dots 65..256: select ≤8 sprites for next line into secOAM
+    int scanSprites(int sprH);     // SpriteEval::Scan; returns the number found
     void renderSpritesForLine();   // dot 257: build sprite line buffers from secOAM
 
     // VBlank / NMI
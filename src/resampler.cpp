@@ -0,0 +1,141 @@
+// resampler.cpp
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "cpu_features.h"
+
+#ifdef NES_X86
+#include <immintrin.h>
+#endif
+
+// ===== Inner products (taps is a multiple of 8) =====
+static float dotScalar(const float* x, const float* k, int taps) {
+    float acc[4] = {0, 0, 0, 0};
+    for (int i = 0; i < taps; i += 4) {
+        acc[0] += x[i + 0] * k[i + 0];
+        acc[1] += x[i + 1] * k[i + 1];
+        acc[2] += x[i + 2] * k[i + 2];
+        acc[3] += x[i + 3] * k[i + 3];
+    }
+    return (acc[0] + acc[2]) + (acc[1] + acc[3]);
+}
+
+#ifdef NES_X86
+NES_TARGET_SSE2 static float dotSSE2(const float* x, const float* k, int taps) {
+    __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+    for (int i = 0; i < taps; i += 8) {
+        a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(k + i)));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(k + i + 4)));
+    }
+    __m128 a = _mm_add_ps(a0, a1);
+    a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+    a = _mm_add_ss(a, _mm_shuffle_ps(a, a, 1));
+    return _mm_cvtss_f32(a);
+}
+
+NES_TARGET_AVX2 static float dotAVX2(const float* x, const float* k, int taps) {
+    __m256 a = _mm256_setzero_ps();
+    for (int i = 0; i < taps; i += 8) {
+        a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(k + i)));
+    }
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+#endif
+
+Resampler::Isa Resampler::bestIsa() {
+    const CpuFeatures& f = cpuFeatures();
+    if (f.avx2) return Isa::AVX2;
+    if (f.sse2) return Isa::SSE2;
+    return Isa::Scalar;
+}
+
+const char* Resampler::isaName(Isa isa) {
+    switch (isa) {
+        case Isa::AVX2:
+            return "AVX2";
+        case Isa::SSE2:
+            return "SSE2";
+        default:
+            return "scalar";
+    }
+}
+
+void Resampler::forceIsa(Isa isa) {
+    const CpuFeatures& f = cpuFeatures();
+    if (isa == Isa::AVX2 && !f.avx2) isa = Isa::SSE2;
+    if (isa == Isa::SSE2 && !f.sse2) isa = Isa::Scalar;
+    active = isa;
+    dot = &dotScalar;
+#ifdef NES_X86
+    if (isa == Isa::SSE2) dot = &dotSSE2;
+    if (isa == Isa::AVX2) dot = &dotAVX2;
+#endif
+}
+
+void Resampler::init(double inRate, double outRate, Quality quality, double maxStep) {
+    q = quality;
+    nTaps = tapsFor(quality);
+    forceIsa(bestIsa());
+
+    // Windowed sinc (Blackman). The cutoff sits below the lower of the two
+    // Nyquist limits, with room for the rate controller to raise the step.
+    double base = inRate / outRate;
+    maxStep = std::max(maxStep, base);
+    const double pi = 3.14159265358979323846;
+    const double fc = 0.5 * std::min(1.0, 1.0 / maxStep) * (q == Quality::Low ? 0.8 : 0.9);
+    const double half = nTaps / 2.0;
+    kernel.assign((size_t)kPhases * nTaps, 0.0f);
+    for (int p = 0; p < kPhases; ++p) {
+        float* row = &kernel[(size_t)p * nTaps];
+        double frac = (double)p / kPhases, sum = 0.0;
+        for (int j = 0; j < nTaps; ++j) {
+            double x = j - (half - 1.0) - frac;  // distance from the output instant
+            double sinc = (x == 0.0) ? 2.0 * fc : std::sin(2.0 * pi * fc * x) / (pi * x);
+            double w = 0.42 + 0.5 * std::cos(pi * x / half) + 0.08 * std::cos(2.0 * pi * x / half);
+            row[j] = (float)(sinc * w);
+            sum += row[j];
+        }
+        for (int j = 0; j < nTaps; ++j) row[j] = (float)(row[j] / sum);  // unity DC gain per phase
+    }
+
+    setStep(base);
+    reset();
+}
+
+void Resampler::setStep(double inPerOut) {
+    step = (uint64_t)std::llround(inPerOut * 4294967296.0);
+}
+
+void Resampler::reset() {
+    hist.assign((size_t)nTaps - 1, 0.0f);
+    pos = 0;
+}
+
+int Resampler::process(const int16_t* in, int n, int16_t* out, int maxOut) {
+    size_t keep = hist.size();
+    hist.resize(keep + (size_t)n);
+    for (int i = 0; i < n; ++i) hist[keep + i] = in[i];
+    if (hist.size() < (size_t)nTaps) return 0;
+
+    const uint64_t end = (uint64_t)(hist.size() - (size_t)nTaps + 1) << 32;  // last full window
+    int produced = 0;
+    while (pos < end) {
+        const float* x = &hist[(size_t)(pos >> 32)];
+        const float* k = &kernel[(size_t)((pos >> (32 - kPhaseBits)) & (kPhases - 1)) * nTaps];
+        float y = std::clamp(dot(x, k, nTaps), -32768.0f, 32767.0f);
+        if (produced < maxOut) out[produced++] = (int16_t)(y < 0.0f ? y - 0.5f : y + 0.5f);
+        pos += step;
+    }
+
+    // Slide: keep everything from the next window's first sample on
+    size_t consumed = std::min((size_t)(pos >> 32), hist.size());
+    hist.erase(hist.begin(), hist.begin() + (ptrdiff_t)consumed);
+    pos -= (uint64_t)consumed << 32;
+    return produced;
+}
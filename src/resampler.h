@@ -0,0 +1,47 @@
+// resampler.h
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Polyphase FIR sample-rate converter (mono, int16 in/out).
+// The APU synthesizes at a fixed internal rate; this converts a whole frame of
+// it to the device rate in one call. The step is adjustable between calls so
+// the dynamic rate control can steer it. Inner products run on AVX2 or SSE2
+// when the CPU has them, with a scalar fallback.
+struct Resampler {
+    enum class Quality { Low, Medium, High };  // 8 / 16 / 32 taps
+    enum class Isa { Scalar, SSE2, AVX2 };
+
+    static constexpr int kPhaseBits = 8;  // 256 sub-sample kernel positions
+    static constexpr int kPhases = 1 << kPhaseBits;
+
+    static int tapsFor(Quality q) { return q == Quality::High ? 32 : q == Quality::Medium ? 16 : 8; }
+    static Isa bestIsa();
+    static const char* isaName(Isa isa);
+
+    // `maxStep` bounds the input/output ratio the kernel must anti-alias for
+    void init(double inRate, double outRate, Quality q, double maxStep = 0.0);
+    void setStep(double inPerOut);  // input samples per output sample
+    void forceIsa(Isa isa);         // benchmarking; clamped to what the CPU has
+    void reset();                   // drop history (silence)
+
+    Quality quality() const { return q; }
+    Isa isa() const { return active; }
+    int taps() const { return nTaps; }
+
+    // Consumes all `n` input samples, writes up to `maxOut` outputs, returns how many.
+    // Outputs that did not fit are lost; size `out` for n / step + 1.
+    int process(const int16_t* in, int n, int16_t* out, int maxOut);
+
+   private:
+    using DotFn = float (*)(const float* x, const float* k, int taps);
+
+    Quality q = Quality::Medium;
+    Isa active = Isa::Scalar;
+    DotFn dot = nullptr;
+    int nTaps = 16;
+    uint64_t step = 0;  // input samples per output, 32.32 fixed point
+    uint64_t pos = 0;   // next output position relative to hist[0], 32.32
+    std::vector<float> kernel;  // kPhases rows of nTaps
+    std::vector<float> hist;    // nTaps-1 samples of history followed by new input
+};
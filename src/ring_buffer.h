@@ -0,0 +1,74 @@
+// ring_buffer.h
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Lock-free single-producer / single-consumer ring of trivially copyable items.
+// Capacity is rounded up to a power of two; head/tail are free-running counters
+// so "full" and "empty" never alias.
+template <typename T>
+struct SpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRing needs trivially copyable items");
+
+    void init(size_t minCapacity) {
+        size_t cap = 1;
+        while (cap < minCapacity) cap <<= 1;
+        buf.assign(cap, T{});
+        mask = cap - 1;
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return buf.size(); }
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    // Producer: copies up to n items, returns how many fit
+    size_t push(const T* src, size_t n) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+        n = std::min(n, capacity() - (t - h));
+        copyIn(t, src, n);
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer: copies up to n items, returns how many were available
+    size_t pop(T* dst, size_t n) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t t = tail.load(std::memory_order_acquire);
+        n = std::min(n, t - h);
+        copyOut(h, dst, n);
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side only (or with the producer stopped)
+    void clear() { head.store(tail.load(std::memory_order_acquire), std::memory_order_release); }
+
+   private:
+    void copyIn(size_t pos, const T* src, size_t n) {
+        if (n == 0) return;
+        size_t i = pos & mask;
+        size_t first = std::min(n, capacity() - i);
+        std::memcpy(&buf[i], src, first * sizeof(T));
+        std::memcpy(&buf[0], src + first, (n - first) * sizeof(T));
+    }
+    void copyOut(size_t pos, T* dst, size_t n) const {
+        if (n == 0) return;
+        size_t i = pos & mask;
+        size_t first = std::min(n, capacity() - i);
+        std::memcpy(dst, &buf[i], first * sizeof(T));
+        std::memcpy(dst + first, &buf[0], (n - first) * sizeof(T));
+    }
+
+    std::vector<T> buf;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> head{0};  // consumer
+    alignas(64) std::atomic<size_t> tail{0};  // producer
+};
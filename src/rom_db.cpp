@@ -0,0 +1,178 @@
+// rom_db.cpp
+#include "rom_db.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+constexpr char kMagic[6] = {'N', 'E', 'S', 'D', 'B', 0x1A};
+constexpr size_t kHeaderSize = 16;
+constexpr uint32_t kEmpty = 0xFFFFFFFFu;
+
+uint32_t readU32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);  // little-endian hosts
+    return v;
+}
+
+bool parseSha1(const std::string& hex, uint8_t out[20]) {
+    std::memset(out, 0, 20);
+    if (hex == "-") return true;
+    if (hex.size() != 40) return false;
+    for (int i = 0; i < 20; ++i) {
+        char byte[3] = {hex[2 * i], hex[2 * i + 1], 0};
+        char* end;
+        out[i] = (uint8_t)std::strtoul(byte, &end, 16);
+        if (*end) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool RomDbRecord::matches(const RomDigest& d) const {
+    static const uint8_t kNoSha[20] = {};
+    return crc32 == d.crc32 && (std::memcmp(sha1, kNoSha, 20) == 0 || std::memcmp(sha1, d.sha1, 20) == 0);
+}
+
+void RomDbRecord::applyTo(RomHeader& h) const {
+    h.mapperId = mapperId;
+    h.submapper = submapper;
+    h.mirroring = mirroring;
+    h.prgRamKB = prgRamKB;
+    h.prgNvramKB = prgNvramKB;
+    h.chrRamKB = chrRamKB;
+    h.battery = prgNvramKB > 0;
+    h.hints = hints;
+}
+
+const RomDatabase& RomDatabase::shared() {
+    static RomDatabase db;
+    static const bool opened = [] {
+        const char* env = std::getenv("NES_ROMDB");
+        return db.open(env && *env ? env : "nesdb.bin");
+    }();
+    (void)opened;
+    return db;
+}
+
+bool RomDatabase::open(const std::string& path) {
+    buckets = nullptr;
+    records = nullptr;
+    bucketMask = recordCount = 0;
+    if (!file.open(path)) return false;
+
+    const uint8_t* p = file.data();
+    const size_t size = file.size();
+    uint16_t version = 0;
+    if (size >= kHeaderSize) std::memcpy(&version, p + 6, 2);
+    const uint32_t nBuckets = size >= kHeaderSize ? readU32(p + 8) : 0;
+    const uint32_t nRecords = size >= kHeaderSize ? readU32(p + 12) : 0;
+    const bool ok = size >= kHeaderSize && std::memcmp(p, kMagic, 6) == 0 && version == kVersion && nBuckets &&
+                    (nBuckets & (nBuckets - 1)) == 0 && nRecords <= nBuckets / 2 &&
+                    size == kHeaderSize + (uint64_t)nBuckets * 4 + (uint64_t)nRecords * sizeof(RomDbRecord);
+    if (!ok) {
+        file.close();
+        return false;
+    }
+    buckets = reinterpret_cast<const uint32_t*>(p + kHeaderSize);
+    records = reinterpret_cast<const RomDbRecord*>(p + kHeaderSize + (size_t)nBuckets * 4);
+    bucketMask = nBuckets - 1;
+    recordCount = nRecords;
+    return true;
+}
+
+const RomDbRecord* RomDatabase::find(const RomDigest& d) const {
+    if (!recordCount) return nullptr;
+    // At most half full, so the probe ends at an empty bucket; capped at one
+    // lap anyway, since a corrupt file may have none
+    for (uint32_t i = d.crc32 & bucketMask, n = 0; n <= bucketMask; i = (i + 1) & bucketMask, ++n) {
+        const uint32_t idx = buckets[i];
+        if (idx == kEmpty || idx >= recordCount) return nullptr;
+        if (records[idx].matches(d)) return &records[idx];
+    }
+    return nullptr;
+}
+
+std::vector<uint8_t> RomDatabase::build(const std::vector<RomDbRecord>& in) {
+    uint32_t nBuckets = 2;
+    while (nBuckets < in.size() * 2) nBuckets <<= 1;
+
+    std::vector<RomDbRecord> recs;
+    std::vector<uint32_t> table(nBuckets, kEmpty);
+    for (const RomDbRecord& r : in) {
+        uint32_t i = r.crc32 & (nBuckets - 1);
+        bool dup = false;
+        for (; table[i] != kEmpty && !dup; i = (i + 1) & (nBuckets - 1))
+            dup = recs[table[i]].crc32 == r.crc32 && std::memcmp(recs[table[i]].sha1, r.sha1, 20) == 0;
+        if (dup) continue;
+        table[i] = (uint32_t)recs.size();
+        recs.push_back(r);
+    }
+
+    std::vector<uint8_t> out(kHeaderSize + (size_t)nBuckets * 4 + recs.size() * sizeof(RomDbRecord));
+    const uint32_t nRecords = (uint32_t)recs.size();
+    std::memcpy(&out[0], kMagic, 6);
+    std::memcpy(&out[6], &kVersion, 2);
+    std::memcpy(&out[8], &nBuckets, 4);
+    std::memcpy(&out[12], &nRecords, 4);
+    std::memcpy(&out[kHeaderSize], table.data(), (size_t)nBuckets * 4);
+    if (!recs.empty())
+        std::memcpy(&out[kHeaderSize + (size_t)nBuckets * 4], recs.data(), recs.size() * sizeof(RomDbRecord));
+    return out;
+}
+
+int runRomDbBuild(int argc, char** argv) {
+    if (argc < 4) {
+        std::fprintf(stderr, "usage: nes --build-romdb <in.txt> <out.bin>\n");
+        return 1;
+    }
+    std::ifstream in(argv[2]);
+    if (!in) {
+        std::fprintf(stderr, "romdb: can't open %s\n", argv[2]);
+        return 1;
+    }
+
+    std::vector<RomDbRecord> recs;
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        std::string crc, sha, mir;
+        unsigned long mapper, submapper, prgRam, nvram, chrRam, hints;
+        if (!(ss >> crc)) continue;  // blank or comment
+        RomDbRecord r{};
+        char* end;
+        r.crc32 = (uint32_t)std::strtoul(crc.c_str(), &end, 16);
+        const bool ok = !*end && (ss >> sha >> mapper >> submapper >> mir >> prgRam >> nvram >> chrRam) &&
+                        (ss >> std::setbase(0) >> hints) && parseSha1(sha, r.sha1) && mapper < 4096 &&
+                        submapper < 16 && (mir == "h" || mir == "v" || mir == "4") && prgRam < 65536 &&
+                        nvram < 65536 && chrRam < 65536;
+        if (!ok) {
+            std::fprintf(stderr, "romdb: %s:%d: malformed entry\n", argv[2], lineNo);
+            return 1;
+        }
+        r.mapperId = (uint16_t)mapper;
+        r.submapper = (uint8_t)submapper;
+        r.mirroring = mir == "h" ? 0 : mir == "v" ? 1 : 4;
+        r.prgRamKB = (uint16_t)prgRam;
+        r.prgNvramKB = (uint16_t)nvram;
+        r.chrRamKB = (uint16_t)chrRam;
+        r.hints = (uint32_t)hints;
+        recs.push_back(r);
+    }
+
+    const std::vector<uint8_t> image = RomDatabase::build(recs);
+    std::ofstream out(argv[3], std::ios::binary | std::ios::trunc);
+    if (!out || !out.write(reinterpret_cast<const char*>(image.data()), (std::streamsize)image.size())) {
+        std::fprintf(stderr, "romdb: can't write %s\n", argv[3]);
+        return 1;
+    }
+    std::printf("romdb: %zu entries -> %s (%zu bytes)\n", recs.size(), argv[3], image.size());
+    return 0;
+}
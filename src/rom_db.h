@@ -0,0 +1,65 @@
+// rom_db.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "rom_hash.h"
+#include "rom_image.h"
+
+// Known-good header fields for a dump whose own header may be wrong
+// (mirroring, RAM sizes, battery bit, mapper), plus emulation hints. One
+// fixed-size little-endian record per dump, keyed by the CRC-32 of
+// PRG+CHR and confirmed by its SHA-1.
+struct RomDbRecord {
+    uint32_t crc32;
+    uint8_t sha1[20];  // all zero: trust the CRC-32 alone
+    uint16_t mapperId;
+    uint8_t submapper;
+    uint8_t mirroring;  // 0=horiz, 1=vert, 4=four-screen
+    uint16_t prgRamKB, prgNvramKB, chrRamKB;
+    uint16_t reserved;
+    uint32_t hints;  // RomHint bits
+
+    bool matches(const RomDigest& d) const;
+    void applyTo(RomHeader& h) const;  // battery = prgNvramKB > 0
+};
+static_assert(sizeof(RomDbRecord) == 40, "on-disk layout");
+
+// The database file (nesdb.bin), memory-mapped and used in place:
+//   header   "NESDB\x1A" u16 version, u32 bucket count (power of two), u32 record count
+//   buckets  u32 record index per bucket, open addressing on crc32 with
+//            linear probing, 0xFFFFFFFF = empty; at most half full
+//   records  RomDbRecord[record count]
+// so a lookup hashes the ROM and probes a bucket or two. Files that don't
+// parse are ignored, as is a missing one.
+class RomDatabase {
+   public:
+    static constexpr uint16_t kVersion = 1;
+
+    // What the loader consults: $NES_ROMDB, else nesdb.bin in the working
+    // directory; opened on first use
+    static const RomDatabase& shared();
+
+    bool open(const std::string& path);  // false (and empty) if missing or malformed
+    size_t size() const { return recordCount; }
+    const RomDbRecord* find(const RomDigest& d) const;
+
+    // The file image for `records`; later duplicates of a digest are dropped
+    static std::vector<uint8_t> build(const std::vector<RomDbRecord>& records);
+
+   private:
+    MappedFile file;
+    const uint32_t* buckets = nullptr;
+    const RomDbRecord* records = nullptr;
+    uint32_t bucketMask = 0, recordCount = 0;
+};
+
+// Compiles a text listing into nesdb.bin, from the command line:
+//   nes --build-romdb <in.txt> <out.bin>
+// One dump per line, '#' starts a comment:
+//   crc32 sha1|- mapper submapper h|v|4 prgRamKB prgNvramKB chrRamKB hints [name]
+// Returns the process exit code.
+int runRomDbBuild(int argc, char** argv);
@@ -0,0 +1,232 @@
+// rom_hash.cpp
+#include "rom_hash.h"
+
+#include <cstring>
+
+#include "cpu_features.h"
+
+#ifdef NES_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// ===== CRC-32 =====
+// kCrcTable[k][b]: CRC of byte b followed by k zero bytes
+struct CrcTables {
+    uint32_t t[8][256];
+};
+
+constexpr CrcTables makeCrcTables() {
+    CrcTables c{};
+    for (uint32_t b = 0; b < 256; ++b) {
+        uint32_t r = b;
+        for (int k = 0; k < 8; ++k) r = (r >> 1) ^ (0xEDB88320u & (0u - (r & 1)));
+        c.t[0][b] = r;
+    }
+    for (int k = 1; k < 8; ++k)
+        for (uint32_t b = 0; b < 256; ++b) c.t[k][b] = (c.t[k - 1][b] >> 8) ^ c.t[0][c.t[k - 1][b] & 0xFF];
+    return c;
+}
+constexpr CrcTables kCrc = makeCrcTables();
+
+uint32_t crcScalar(uint32_t reg, const uint8_t* p, size_t n) {
+    for (; n >= 8; p += 8, n -= 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);  // little-endian hosts
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= reg;
+        reg = kCrc.t[7][lo & 0xFF] ^ kCrc.t[6][(lo >> 8) & 0xFF] ^ kCrc.t[5][(lo >> 16) & 0xFF] ^
+              kCrc.t[4][lo >> 24] ^ kCrc.t[3][hi & 0xFF] ^ kCrc.t[2][(hi >> 8) & 0xFF] ^
+              kCrc.t[1][(hi >> 16) & 0xFF] ^ kCrc.t[0][hi >> 24];
+    }
+    for (; n; ++p, --n) reg = (reg >> 8) ^ kCrc.t[0][(reg ^ *p) & 0xFF];
+    return reg;
+}
+
+#ifdef NES_X86
+// acc * x^k mod P folded onto `next` (k's two halves for acc's two halves)
+NES_TARGET_CLMUL inline __m128i clmulFold(__m128i acc, __m128i k, __m128i next) {
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(acc, k, 0x00), _mm_clmulepi64_si128(acc, k, 0x11)), next);
+}
+
+// Gopal et al., "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ"
+// (Intel, 2009), in the bit-reflected domain: four 128-bit lanes fold 64
+// bytes per step, then fold to one lane, to 64 bits, and Barrett-reduce to 32.
+// `n` >= 64 and a multiple of 16.
+NES_TARGET_CLMUL uint32_t crcClmul(uint32_t reg, const uint8_t* p, size_t n) {
+    // Folding constants x^k mod P (bit-reflected) for distances of 512 and
+    // 128 bits and the 64-bit step; then P and mu = x^64 / P for Barrett
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i lo32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    auto load = [](const uint8_t* q) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(q)); };
+
+    __m128i x1 = _mm_xor_si128(load(p), _mm_cvtsi32_si128((int)reg));
+    __m128i x2 = load(p + 16), x3 = load(p + 32), x4 = load(p + 48);
+    for (p += 64, n -= 64; n >= 64; p += 64, n -= 64) {
+        x1 = clmulFold(x1, k1k2, load(p));
+        x2 = clmulFold(x2, k1k2, load(p + 16));
+        x3 = clmulFold(x3, k1k2, load(p + 32));
+        x4 = clmulFold(x4, k1k2, load(p + 48));
+    }
+    x1 = clmulFold(x1, k3k4, x2);
+    x1 = clmulFold(x1, k3k4, x3);
+    x1 = clmulFold(x1, k3k4, x4);
+    for (; n >= 16; p += 16, n -= 16) x1 = clmulFold(x1, k3k4, load(p));
+
+    // 128 -> 64 bits
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), _mm_clmulepi64_si128(x1, k3k4, 0x10));
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 4), _mm_clmulepi64_si128(_mm_and_si128(x1, lo32), k5, 0x00));
+    // Barrett reduction
+    __m128i t = _mm_clmulepi64_si128(_mm_and_si128(x1, lo32), poly, 0x10);
+    t = _mm_clmulepi64_si128(_mm_and_si128(t, lo32), poly, 0x00);
+    return (uint32_t)_mm_extract_epi32(_mm_xor_si128(x1, t), 1);
+}
+#endif
+
+// ===== SHA-1 =====
+inline uint32_t rol(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+void sha1Scalar(uint32_t st[5], const uint8_t* p, size_t count) {
+    for (; count; --count, p += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i)
+            w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+        for (int i = 16; i < 80; ++i) w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = st[0], b = st[1], c = st[2], d = st[3], e = st[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) f = (b & c) | (~b & d), k = 0x5A827999u;
+            else if (i < 40) f = b ^ c ^ d, k = 0x6ED9EBA1u;
+            else if (i < 60) f = (b & c) | (b & d) | (c & d), k = 0x8F1BBCDCu;
+            else f = b ^ c ^ d, k = 0xCA62C1D6u;
+            const uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d, d = c, c = rol(b, 30), b = a, a = t;
+        }
+        st[0] += a, st[1] += b, st[2] += c, st[3] += d, st[4] += e;
+    }
+}
+
+#ifdef NES_X86
+// 4 rounds per SHA1RNDS4 (function/constant picked by the immediate);
+// SHA1NEXTE derives the next group's E from the ABCD before this one, and
+// SHA1MSG1/2 extend the schedule: W[t] from W[t-16..t-1], 4 words at a time
+NES_TARGET_SHA void sha1Sha(uint32_t st[5], const uint8_t* p, size_t count) {
+    const __m128i bswap = _mm_set_epi64x(0x0001020304050607ll, 0x08090a0b0c0d0e0fll);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(st)), 0x1B);
+    __m128i e0 = _mm_set_epi32((int)st[4], 0, 0, 0);
+
+    for (; count; --count, p += 64) {
+        const __m128i abcdSave = abcd, e0Save = e0;
+        __m128i m[4];
+        for (int i = 0; i < 4; ++i)
+            m[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i)), bswap);
+
+        __m128i e = _mm_add_epi32(e0, m[0]), prev = abcd;
+        for (int g = 0; g < 20; ++g) {
+            if (g >= 4)
+                m[g & 3] = _mm_sha1msg2_epu32(
+                    _mm_xor_si128(_mm_sha1msg1_epu32(m[g & 3], m[(g + 1) & 3]), m[(g + 2) & 3]), m[(g + 3) & 3]);
+            if (g > 0) e = _mm_sha1nexte_epu32(prev, m[g & 3]);
+            prev = abcd;
+            switch (g / 5) {
+                case 0: abcd = _mm_sha1rnds4_epu32(abcd, e, 0); break;
+                case 1: abcd = _mm_sha1rnds4_epu32(abcd, e, 1); break;
+                case 2: abcd = _mm_sha1rnds4_epu32(abcd, e, 2); break;
+                default: abcd = _mm_sha1rnds4_epu32(abcd, e, 3); break;
+            }
+        }
+        e0 = _mm_sha1nexte_epu32(prev, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(st), _mm_shuffle_epi32(abcd, 0x1B));
+    st[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+#endif
+
+}  // namespace
+
+// ===== Crc32 =====
+Crc32::Isa Crc32::bestIsa() { return cpuFeatures().pclmul ? Isa::PCLMUL : Isa::Scalar; }
+
+const char* Crc32::isaName(Isa isa) { return isa == Isa::PCLMUL ? "PCLMUL" : "scalar"; }
+
+void Crc32::forceIsa(Isa isa) {
+    if (isa == Isa::PCLMUL && !cpuFeatures().pclmul) isa = Isa::Scalar;
+    active = isa;
+}
+
+void Crc32::update(const void* data, size_t n) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+#ifdef NES_X86
+    if (active == Isa::PCLMUL && n >= 64) {
+        const size_t bulk = n & ~(size_t)15;
+        reg = crcClmul(reg, p, bulk);
+        p += bulk;
+        n -= bulk;
+    }
+#endif
+    reg = crcScalar(reg, p, n);
+}
+
+// ===== Sha1 =====
+Sha1::Isa Sha1::bestIsa() { return cpuFeatures().sha ? Isa::SHA : Isa::Scalar; }
+
+const char* Sha1::isaName(Isa isa) { return isa == Isa::SHA ? "SHA-NI" : "scalar"; }
+
+void Sha1::forceIsa(Isa isa) {
+    if (isa == Isa::SHA && !cpuFeatures().sha) isa = Isa::Scalar;
+    active = isa;
+    blockFn = &sha1Scalar;
+#ifdef NES_X86
+    if (isa == Isa::SHA) blockFn = &sha1Sha;
+#endif
+}
+
+void Sha1::update(const void* data, size_t n) {
+    if (!n) return;
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    total += n;
+    if (bufLen) {
+        const size_t take = n < 64 - bufLen ? n : 64 - bufLen;
+        std::memcpy(buf + bufLen, p, take);
+        bufLen += take, p += take, n -= take;
+        if (bufLen < 64) return;
+        blockFn(state, buf, 1);
+        bufLen = 0;
+    }
+    if (n >= 64) {
+        blockFn(state, p, n / 64);
+        p += n & ~(size_t)63;
+        n &= 63;
+    }
+    std::memcpy(buf, p, n);
+    bufLen = n;
+}
+
+void Sha1::finish(uint8_t out[20]) {
+    const uint64_t bits = total * 8;
+    uint8_t pad[72] = {0x80};
+    const size_t padLen = (bufLen < 56 ? 56 : 120) - bufLen;
+    for (int i = 0; i < 8; ++i) pad[padLen + i] = (uint8_t)(bits >> (56 - 8 * i));
+    update(pad, padLen + 8);
+    for (int i = 0; i < 5; ++i)
+        for (int b = 0; b < 4; ++b) out[4 * i + b] = (uint8_t)(state[i] >> (24 - 8 * b));
+}
+
+RomDigest hashRom(RomSpan prg, RomSpan chr) {
+    RomDigest d;
+    Crc32 crc;
+    Sha1 sha;
+    for (RomSpan s : {prg, chr}) {
+        crc.update(s.data(), s.size());
+        sha.update(s.data(), s.size());
+    }
+    d.crc32 = crc.value();
+    sha.finish(d.sha1);
+    return d;
+}
@@ -0,0 +1,62 @@
+// rom_hash.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "rom_image.h"
+
+// Streaming CRC-32 (IEEE, reflected 0xEDB88320: zip, No-Intro, NesCartDB).
+// Scalar is slicing-by-8; PCLMUL folds 64 bytes per step with carry-less
+// multiplies and Barrett-reduces the tail.
+struct Crc32 {
+    enum class Isa { Scalar, PCLMUL };
+
+    static Isa bestIsa();
+    static const char* isaName(Isa isa);
+
+    Crc32() { forceIsa(bestIsa()); }
+    void forceIsa(Isa isa);  // benchmarking; clamped to what the CPU has
+    Isa isa() const { return active; }
+
+    void update(const void* data, size_t n);
+    uint32_t value() const { return ~reg; }
+
+   private:
+    uint32_t reg = ~0u;
+    Isa active = Isa::Scalar;
+};
+
+// Streaming SHA-1. Scalar is the FIPS 180 rounds; SHA uses the SHA-NI
+// round and message-schedule instructions.
+struct Sha1 {
+    enum class Isa { Scalar, SHA };
+
+    static Isa bestIsa();
+    static const char* isaName(Isa isa);
+
+    Sha1() { forceIsa(bestIsa()); }
+    void forceIsa(Isa isa);  // benchmarking; clamped to what the CPU has
+    Isa isa() const { return active; }
+
+    void update(const void* data, size_t n);
+    void finish(uint8_t out[20]);  // pads; the object is spent afterwards
+
+   private:
+    using BlockFn = void (*)(uint32_t state[5], const uint8_t* blocks, size_t count);
+
+    uint32_t state[5] = {0x67452301u, 0xEFCDAB89u, 0x98BADCFEu, 0x10325476u, 0xC3D2E1F0u};
+    uint8_t buf[64];
+    size_t bufLen = 0;
+    uint64_t total = 0;  // bytes
+    Isa active = Isa::Scalar;
+    BlockFn blockFn = nullptr;
+};
+
+// What the ROM database is keyed by: hashes of PRG-ROM followed by CHR-ROM,
+// header and trainer excluded
+struct RomDigest {
+    uint32_t crc32 = 0;
+    uint8_t sha1[20] = {};
+};
+
+RomDigest hashRom(RomSpan prg, RomSpan chr);
@@ -0,0 +1,94 @@
+// rom_image.cpp
+#include "rom_image.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+// NES 2.0 ROM size from the iNES LSB byte and the MSB nibble in byte 9. An
+// MSB of $F is the exponent-multiplier form: 2^E * (MM*2+1) bytes.
+size_t nes2RomSize(uint8_t lsb, uint8_t msb, size_t unit) {
+    if (msb != 0x0F) return ((size_t)msb << 8 | lsb) * unit;
+    const unsigned exp = lsb >> 2;
+    if (exp > 30) throw std::runtime_error("ROM size out of range");
+    return ((size_t)1 << exp) * ((lsb & 3) * 2 + 1);
+}
+
+// NES 2.0 RAM sizes are 64 << shift bytes (shift 0 = none); rounded up to KiB
+uint32_t nes2RamKB(uint8_t shift) {
+    return shift ? ((64u << shift) + 1023) / 1024 : 0;
+}
+
+}  // namespace
+
+std::shared_ptr<const RomImage> RomImage::mapFile(const std::string& path) {
+    std::shared_ptr<RomImage> img(new RomImage());
+    if (img->file.open(path)) {
+        img->all = RomSpan(img->file.data(), img->file.size());
+    } else {
+        std::ifstream f(path, std::ios::binary);
+        if (!f) throw std::runtime_error("Failed to open ROM: " + path);
+        img->owned.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+        img->all = RomSpan(img->owned);
+    }
+    img->parse();
+    return img;
+}
+
+std::shared_ptr<const RomImage> RomImage::fromBuffer(std::vector<uint8_t> bytes) {
+    std::shared_ptr<RomImage> img(new RomImage());
+    img->owned = std::move(bytes);
+    img->all = RomSpan(img->owned);
+    img->parse();
+    return img;
+}
+
+std::shared_ptr<const RomImage> RomImage::fromMemory(const void* data, size_t size) {
+    std::shared_ptr<RomImage> img(new RomImage());
+    img->all = RomSpan((const uint8_t*)data, size);
+    img->parse();
+    return img;
+}
+
+void RomImage::parse() {
+    const uint8_t* h = all.data();
+    if (all.size() < 16 || h[0] != 'N' || h[1] != 'E' || h[2] != 'S' || h[3] != 0x1A)
+        throw std::runtime_error("Not an iNES file");
+
+    const uint8_t f6 = h[6], f7 = h[7];
+    header.nes2 = ((f7 & 0x0C) == 0x08);
+    header.mapperId = ((f7 & 0xF0) | (f6 >> 4));
+    header.mirroring = (f6 & 0x08) ? 4 : ((f6 & 1) ? 1 : 0);
+
+    size_t prgSize, chrSize;
+    if (header.nes2) {
+        header.mapperId |= (uint16_t)(h[8] & 0x0F) << 8;
+        header.submapper = h[8] >> 4;
+        prgSize = nes2RomSize(h[4], h[9] & 0x0F, 16 * 1024);
+        chrSize = nes2RomSize(h[5], h[9] >> 4, 8 * 1024);
+        header.prgRamKB = nes2RamKB(h[10] & 0x0F);
+        header.prgNvramKB = nes2RamKB(h[10] >> 4);
+        if (chrSize == 0) header.chrRamKB = (h[11] & 0x0F) ? nes2RamKB(h[11] & 0x0F) : 8;
+        header.battery = header.prgNvramKB > 0;
+    } else {
+        prgSize = (size_t)h[4] * 16 * 1024;
+        chrSize = (size_t)h[5] * 8 * 1024;
+        header.prgRamKB = h[8] ? (h[8] * 8u) : 8u;
+        header.prgNvramKB = (f6 & 0x02) ? 8u : 0u;
+        if (chrSize == 0) header.chrRamKB = 8;
+        header.battery = (f6 & 0x02) != 0;
+    }
+
+    size_t at = 16;
+    auto take = [&](size_t n, const char* what) {
+        if (all.size() - at < n) throw std::runtime_error(std::string("Truncated ROM: ") + what);
+        RomSpan s(h + at, n);
+        at += n;
+        return s;
+    };
+    if (f6 & 0x04) trainer = take(512, "trainer");
+    prg = take(prgSize, "PRG-ROM");
+    chr = take(chrSize, "CHR-ROM");
+}
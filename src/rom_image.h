@@ -0,0 +1,77 @@
+// rom_image.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+// Read-only bytes of a ROM image, borrowed from whoever owns them (a
+// std::span<const uint8_t> stand-in)
+class RomSpan {
+   public:
+    RomSpan() = default;
+    RomSpan(const uint8_t* p, size_t n) : ptr(p), len(n) {}
+    RomSpan(const std::vector<uint8_t>& v) : ptr(v.data()), len(v.size()) {}
+
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    const uint8_t& operator[](size_t i) const { return ptr[i]; }
+
+   private:
+    const uint8_t* ptr = nullptr;
+    size_t len = 0;
+};
+
+// Per-game emulation hints; set only by the ROM database (see rom_db.h)
+enum RomHint : uint32_t {
+    kHintNoBusConflicts = 1u << 0,  // discrete board without bus conflicts whatever its submapper
+};
+
+// iNES / NES 2.0 header fields the loader needs
+struct RomHeader {
+    uint16_t mapperId = 0;
+    uint8_t submapper = 0;  // NES 2.0 only
+    uint8_t mirroring = 0;  // 0=horiz, 1=vert, 4=four-screen
+    bool nes2 = false;
+    bool battery = false;
+    uint32_t prgRamKB = 8;    // volatile PRG-RAM
+    uint32_t prgNvramKB = 0;  // battery-backed PRG-NVRAM
+    uint32_t chrRamKB = 0;    // 0 when the image has CHR-ROM
+    uint32_t hints = 0;       // RomHint bits
+};
+
+// A whole .nes file: a read-only mapping of the file, or a buffer for ROMs
+// that never touch the disk (embedded, tests). The header is parsed in place
+// and the trainer, PRG and CHR are spans into the image, so a cartridge
+// runs from the file's pages and allocates only its RAM. Images are shared
+// and immutable; keep one alive for as long as anything holds its spans.
+class RomImage {
+   public:
+    // All throw std::runtime_error if the image is not a complete iNES file
+    static std::shared_ptr<const RomImage> mapFile(const std::string& path);
+    static std::shared_ptr<const RomImage> fromBuffer(std::vector<uint8_t> bytes);
+    // Borrows `data`, which must outlive the image
+    static std::shared_ptr<const RomImage> fromMemory(const void* data, size_t size);
+
+    RomImage(const RomImage&) = delete;
+    RomImage& operator=(const RomImage&) = delete;
+
+    RomSpan bytes() const { return all; }
+    bool mapped() const { return file.isOpen(); }
+
+    RomHeader header;
+    RomSpan trainer;  // 512 bytes for $7000, or empty
+    RomSpan prg, chr;
+
+   private:
+    RomImage() = default;
+    void parse();  // fills header and spans from `all`
+
+    RomSpan all;
+    std::vector<uint8_t> owned;  // fromBuffer, or the fallback read
+    MappedFile file;             // mapFile
+};
@@ -0,0 +1,225 @@
+// rom_library.cpp
+#include "rom_library.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "rom_db.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char* kIndexMagic = "nes-rom-index";
+constexpr int kIndexVersion = 1;
+constexpr auto kPublishEvery = std::chrono::milliseconds(100);
+
+bool isNesFile(const fs::path& p) {
+    std::string ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return ext == ".nes";
+}
+
+void parseEntry(RomEntry& e) {
+    try {
+        const auto img = RomImage::mapFile(e.path);
+        e.digest = hashRom(img->prg, img->chr);
+        const RomDbRecord* rec = RomDatabase::shared().find(e.digest);
+        e.mapperId = rec ? rec->mapperId : img->header.mapperId;
+        e.valid = true;
+    } catch (const std::exception&) {
+        e.digest = RomDigest{};
+        e.mapperId = 0;
+        e.valid = false;
+    }
+}
+
+std::string sha1Hex(const uint8_t sha1[20]) {
+    char hex[41];
+    for (int i = 0; i < 20; ++i) std::snprintf(hex + 2 * i, 3, "%02x", sha1[i]);
+    return hex;
+}
+
+bool parseSha1Hex(const std::string& hex, uint8_t out[20]) {
+    if (hex.size() != 40) return false;
+    for (int i = 0; i < 20; ++i) {
+        char byte[3] = {hex[2 * i], hex[2 * i + 1], 0};
+        char* end;
+        out[i] = (uint8_t)std::strtoul(byte, &end, 16);
+        if (*end) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+RomLibrary::RomLibrary(std::string path) : indexPath(std::move(path)) {}
+
+RomLibrary::~RomLibrary() { cancel(); }
+
+void RomLibrary::scan(const std::string& root) {
+    cancel();
+    stop.store(false);
+    busy.store(true);
+    std::error_code ec;
+    fs::path abs = fs::absolute(root, ec);
+    thr = std::thread(&RomLibrary::run, this, (ec ? fs::path(root) : abs).lexically_normal().string());
+}
+
+void RomLibrary::cancel() {
+    stop.store(true);
+    if (thr.joinable()) thr.join();
+}
+
+uint64_t RomLibrary::snapshot(std::vector<RomEntry>& out) const {
+    std::lock_guard<std::mutex> lk(mtx);
+    out = listing;
+    return published.load(std::memory_order_relaxed);
+}
+
+void RomLibrary::publish(std::vector<RomEntry> entries) {
+    std::lock_guard<std::mutex> lk(mtx);
+    listing = std::move(entries);
+    published.fetch_add(1, std::memory_order_release);
+}
+
+void RomLibrary::run(std::string root) {
+    seen.store(0);
+    hashed.store(0);
+    if (!indexLoaded) loadIndex();
+
+    std::string prefix = root;
+    if (prefix.empty() || prefix.back() != fs::path::preferred_separator) prefix += fs::path::preferred_separator;
+    auto underRoot = [&](const std::string& p) { return p.compare(0, prefix.size(), prefix) == 0; };
+
+    // What the index knows goes up first; refreshed entries replace it below
+    std::map<std::string, RomEntry> shown;
+    for (const auto& kv : index)
+        if (underRoot(kv.first)) shown.emplace(kv.first, kv.second);
+    auto publishShown = [&] {
+        std::vector<RomEntry> v;
+        v.reserve(shown.size());
+        for (const auto& kv : shown) v.push_back(kv.second);
+        publish(std::move(v));
+    };
+    publishShown();
+    auto lastPublish = std::chrono::steady_clock::now();
+
+    std::map<std::string, RomEntry> fresh;
+    std::vector<RomEntry> pending;
+    auto flush = [&] {
+        pool.run((int)pending.size(), [&](int i) {
+            if (stop.load(std::memory_order_relaxed)) return;
+            parseEntry(pending[i]);
+            hashed.fetch_add(1, std::memory_order_relaxed);
+        });
+        if (stop.load()) return;
+        for (RomEntry& e : pending) {
+            shown[e.path] = e;
+            fresh[e.path] = std::move(e);
+        }
+        pending.clear();
+    };
+
+    std::error_code ec;
+    fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+    for (; !ec && it != end && !stop.load(); it.increment(ec)) {
+        std::error_code fec;
+        if (!it->is_regular_file(fec) || !isNesFile(it->path())) continue;
+        RomEntry e;
+        e.path = it->path().string();
+        e.size = (uint64_t)it->file_size(fec);
+        if (fec) continue;
+        e.mtime = (int64_t)it->last_write_time(fec).time_since_epoch().count();
+        if (fec) continue;
+        seen.fetch_add(1, std::memory_order_relaxed);
+
+        auto known = index.find(e.path);
+        if (known != index.end() && known->second.mtime == e.mtime && known->second.size == e.size) {
+            fresh[e.path] = known->second;
+        } else {
+            e.title = it->path().stem().string();
+            pending.push_back(std::move(e));
+            if (pending.size() == kBatch) flush();
+        }
+        if (std::chrono::steady_clock::now() - lastPublish >= kPublishEvery) {
+            publishShown();
+            lastPublish = std::chrono::steady_clock::now();
+        }
+    }
+    if (!stop.load()) flush();
+
+    // A cancelled scan keeps what it hashed but can't tell what vanished
+    if (!stop.load()) {
+        for (auto i = index.begin(); i != index.end();)
+            i = underRoot(i->first) ? index.erase(i) : std::next(i);
+    }
+    for (const auto& kv : fresh) index[kv.first] = kv.second;
+
+    if (!stop.load()) {
+        std::vector<RomEntry> v;
+        v.reserve(fresh.size());
+        for (auto& kv : fresh) v.push_back(std::move(kv.second));
+        publish(std::move(v));
+    }
+    saveIndex();
+    busy.store(false);
+}
+
+void RomLibrary::loadIndex() {
+    indexLoaded = true;
+    std::ifstream in(indexPath);
+    std::string line, magic;
+    int version = 0;
+    if (!std::getline(in, line) || !(std::istringstream(line) >> magic >> version) || magic != kIndexMagic ||
+        version != kIndexVersion)
+        return;  // missing or from another version: rebuilt by the scan
+
+    while (std::getline(in, line)) {
+        const size_t tab1 = line.find('\t');
+        const size_t tab2 = tab1 == std::string::npos ? tab1 : line.find('\t', tab1 + 1);
+        if (tab2 == std::string::npos) continue;
+        std::istringstream ss(line.substr(0, tab1));
+        RomEntry e;
+        std::string crc, sha;
+        unsigned mapper;
+        int valid;
+        if (!(ss >> e.mtime >> e.size >> crc >> sha >> mapper >> valid) || !parseSha1Hex(sha, e.digest.sha1)) continue;
+        e.digest.crc32 = (uint32_t)std::strtoul(crc.c_str(), nullptr, 16);
+        e.mapperId = (uint16_t)mapper;
+        e.valid = valid != 0;
+        e.path = line.substr(tab1 + 1, tab2 - tab1 - 1);
+        e.title = line.substr(tab2 + 1);
+        index[e.path] = std::move(e);
+    }
+}
+
+void RomLibrary::saveIndex() const {
+    // Written beside and renamed over, so a crash mid-write keeps the old one
+    const std::string tmp = indexPath + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return;
+        out << kIndexMagic << ' ' << kIndexVersion << '\n';
+        char num[96];
+        for (const auto& kv : index) {
+            const RomEntry& e = kv.second;
+            if (e.path.find_first_of("\t\n") != std::string::npos || e.title.find_first_of("\t\n") != std::string::npos)
+                continue;  // not representable; rehashed next time
+            std::snprintf(num, sizeof(num), "%lld %llu %08x ", (long long)e.mtime, (unsigned long long)e.size,
+                          e.digest.crc32);
+            out << num << sha1Hex(e.digest.sha1) << ' ' << e.mapperId << ' ' << (e.valid ? 1 : 0) << '\t' << e.path
+                << '\t' << e.title << '\n';
+        }
+        if (!out) return;
+    }
+    std::error_code ec;
+    fs::rename(tmp, indexPath, ec);
+}
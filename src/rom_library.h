@@ -0,0 +1,74 @@
+// rom_library.h
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "rom_hash.h"
+#include "thread_pool.h"
+
+// One .nes file as the ROM browser lists it
+struct RomEntry {
+    std::string path;
+    std::string title;      // file name without extension
+    int64_t mtime = 0;      // filesystem clock ticks
+    uint64_t size = 0;      // bytes
+    RomDigest digest;       // PRG+CHR, as the ROM database keys it
+    uint16_t mapperId = 0;
+    bool valid = false;     // parsed as iNES
+};
+
+// The ROM browser's file list, built off the UI thread. scan() walks a
+// folder tree on the scanner thread; files are parsed and hashed in batches
+// on a ThreadPool. Files whose path, mtime and size match the on-disk index
+// are taken from it without being opened, so a rescan of an unchanged
+// library only stats it. Results are published as each batch completes,
+// sorted by path, and the index is rewritten when a scan finishes.
+//
+// Index file: a "nes-rom-index 1" line, then one line per file:
+//   mtime size crc32 sha1 mapper valid<TAB>path<TAB>title
+class RomLibrary {
+   public:
+    explicit RomLibrary(std::string indexPath);
+    ~RomLibrary();  // cancels the scan
+
+    // Any thread. Replaces the listing with `root`'s: first what the index
+    // already knows under it, then the refreshed entries as they arrive.
+    void scan(const std::string& root);
+    void cancel();
+
+    // Bumped whenever the listing changes; cheap to poll every frame
+    uint64_t version() const { return published.load(std::memory_order_acquire); }
+    // Copies the current listing; returns version()
+    uint64_t snapshot(std::vector<RomEntry>& out) const;
+
+    bool scanning() const { return busy.load(std::memory_order_relaxed); }
+    size_t filesSeen() const { return seen.load(std::memory_order_relaxed); }
+    size_t filesHashed() const { return hashed.load(std::memory_order_relaxed); }
+
+   private:
+    static constexpr size_t kBatch = 256;  // files per pool round and per publish
+
+    void run(std::string root);
+    void publish(std::vector<RomEntry> entries);
+    void loadIndex();
+    void saveIndex() const;
+
+    const std::string indexPath;
+    std::unordered_map<std::string, RomEntry> index;  // by path; scanner thread only
+    bool indexLoaded = false;
+
+    ThreadPool pool;
+    std::thread thr;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> busy{false};
+    std::atomic<size_t> seen{0}, hashed{0};
+
+    mutable std::mutex mtx;  // listing
+    std::vector<RomEntry> listing;
+    std::atomic<uint64_t> published{0};
+};
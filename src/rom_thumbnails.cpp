@@ -0,0 +1,222 @@
+// rom_thumbnails.cpp
+#include "rom_thumbnails.h"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "cartridge.h"
+#include "input.h"
+#include "nes.h"
+#include "palette.h"
+#include "ppu.h"
+#include "rom_image.h"
+#include "thread_pool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kMagic[8] = {'N', 'E', 'S', 'T', 'H', 'M', 'B', '1'};
+constexpr int kScale = PPU::WIDTH / RomThumbnails::kWidth;  // 4x4 pixels per thumbnail pixel
+static_assert(PPU::HEIGHT / RomThumbnails::kHeight == kScale, "same scale both ways");
+
+// The boot script: Start is held for a few frames at each press (title
+// screen, then a menu or the game itself), and screens are sampled from
+// kFirstSample on; the last one that isn't a single color is kept
+constexpr int kFrames = 330;
+constexpr int kStartPresses[] = {120, 210};
+constexpr int kPressFrames = 6;
+constexpr int kFirstSample = 60, kSampleEvery = 30;
+constexpr uint8_t kStart = 1u << 3;  // pad bit order: A, B, Select, Start, ...
+
+std::string sha1Hex(const uint8_t sha1[20]) {
+    char hex[41];
+    for (int i = 0; i < 20; ++i) std::snprintf(hex + 2 * i, 3, "%02x", sha1[i]);
+    return hex;
+}
+
+bool singleColor(const PPU& ppu) {
+    const uint8_t* px = ppu.frameIndex;
+    return std::all_of(px, px + PPU::WIDTH * PPU::HEIGHT, [c = px[0]](uint8_t i) { return i == c; });
+}
+
+// Box filter over kScale x kScale blocks, in ARGB8888
+void downscale(const PPU& ppu, std::vector<uint32_t>& out) {
+    const Palette& pal = Palette::ntsc();
+    uint32_t line[PPU::WIDTH];
+    uint32_t sum[RomThumbnails::kWidth][3];
+    out.resize(RomThumbnails::kWidth * RomThumbnails::kHeight);
+    for (int ty = 0; ty < RomThumbnails::kHeight; ++ty) {
+        std::memset(sum, 0, sizeof(sum));
+        for (int y = ty * kScale; y < (ty + 1) * kScale; ++y) {
+            pal.expandLine(ppu.frameIndex + y * PPU::WIDTH, ppu.lineEmphasis[y], line, PPU::WIDTH);
+            for (int x = 0; x < PPU::WIDTH; ++x) {
+                uint32_t* s = sum[x / kScale];
+                s[0] += (line[x] >> 16) & 0xFF;
+                s[1] += (line[x] >> 8) & 0xFF;
+                s[2] += line[x] & 0xFF;
+            }
+        }
+        for (int tx = 0; tx < RomThumbnails::kWidth; ++tx) {
+            const uint32_t* s = sum[tx];
+            const uint32_t n = kScale * kScale;
+            out[ty * RomThumbnails::kWidth + tx] =
+                0xFF000000u | (s[0] + n / 2) / n << 16 | (s[1] + n / 2) / n << 8 | (s[2] + n / 2) / n;
+        }
+    }
+}
+
+}  // namespace
+
+RomThumbnails::RomThumbnails(std::string d) : dir(std::move(d)) {
+    const int n = std::max(1, (int)std::thread::hardware_concurrency() - 1);  // the UI keeps one
+    allowed = n;
+    for (int i = 0; i < n; ++i) workers.emplace_back([this, i] { loop(i); });
+}
+
+RomThumbnails::~RomThumbnails() {
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        quit = true;
+        queue.clear();
+    }
+    cv.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+RomThumbnails::Status RomThumbnails::fetch(const RomEntry& rom, std::vector<uint32_t>& pixels) {
+    if (!rom.valid) return Status::Failed;
+    const std::string key = sha1Hex(rom.digest.sha1);
+    std::lock_guard<std::mutex> lk(mtx);
+    auto it = ready.find(key);
+    if (it != ready.end()) {
+        pixels = std::move(it->second);
+        ready.erase(it);
+        return Status::Ready;
+    }
+    if (failed.count(key)) return Status::Failed;
+
+    // Asked again: still wanted, so move it to the front
+    auto q = std::find_if(queue.begin(), queue.end(), [&](const Job& j) { return j.key == key; });
+    if (q != queue.end()) {
+        if (q != queue.begin()) {
+            Job j = std::move(*q);
+            queue.erase(q);
+            queue.push_front(std::move(j));
+        }
+        return Status::Pending;
+    }
+    if (known.count(key)) return Status::Pending;  // in progress
+
+    queue.push_front({key, rom.path});
+    known.insert(key);
+    if (queue.size() > kMaxQueued) {
+        known.erase(queue.back().key);
+        queue.pop_back();
+    }
+    cv.notify_all();
+    return Status::Pending;
+}
+
+void RomThumbnails::setGameRunning(bool running, int busyHelpers) {
+    const int spare = std::max(0, ThreadPool::defaultHelpers() - busyHelpers);
+    const int n = running ? std::min((int)workers.size(), spare) : (int)workers.size();
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (allowed == n) return;
+        allowed = n;
+    }
+    cv.notify_all();
+}
+
+void RomThumbnails::loop(int worker) {
+    // Below the game's threads, so the scheduler preempts a preview first
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+    std::unique_lock<std::mutex> lk(mtx);
+    for (;;) {
+        cv.wait(lk, [&] { return quit || (worker < allowed && !queue.empty()); });
+        if (quit) return;
+        Job job = std::move(queue.front());
+        queue.pop_front();
+        lk.unlock();
+
+        std::vector<uint32_t> pixels;
+        bool ok = load(job.key, pixels);
+        if (!ok && (ok = generate(job.path, pixels))) save(job.key, pixels);
+
+        lk.lock();
+        known.erase(job.key);
+        if (!ok) {
+            failed.insert(job.key);
+            continue;
+        }
+        // Not fetched since: on disk, so safe to drop
+        if (ready.size() >= 2 * kMaxQueued) ready.erase(ready.begin());
+        ready[job.key] = std::move(pixels);
+    }
+}
+
+bool RomThumbnails::load(const std::string& key, std::vector<uint32_t>& pixels) const {
+    std::ifstream in(dir + "/" + key + ".thumb", std::ios::binary);
+    char magic[8];
+    uint16_t size[2];
+    if (!in.read(magic, 8) || std::memcmp(magic, kMagic, 8) != 0 ||
+        !in.read(reinterpret_cast<char*>(size), sizeof(size)) || size[0] != kWidth || size[1] != kHeight)
+        return false;
+    pixels.resize(kWidth * kHeight);
+    return (bool)in.read(reinterpret_cast<char*>(pixels.data()), (std::streamsize)(pixels.size() * 4));
+}
+
+void RomThumbnails::save(const std::string& key, const std::vector<uint32_t>& pixels) const {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    // Written beside and renamed over, so a reader never sees half a file
+    const std::string path = dir + "/" + key + ".thumb", tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        const uint16_t size[2] = {kWidth, kHeight};
+        out.write(kMagic, 8);
+        out.write(reinterpret_cast<const char*>(size), sizeof(size));  // little-endian hosts
+        out.write(reinterpret_cast<const char*>(pixels.data()), (std::streamsize)(pixels.size() * 4));
+        if (!out) return;
+    }
+    fs::rename(tmp, path, ec);
+}
+
+bool RomThumbnails::generate(const std::string& path, std::vector<uint32_t>& pixels) {
+    NES nes;
+    try {
+        // Not loadROM: a cartridge built from the bare image has no path, so
+        // the player's save is neither read nor written
+        nes.cart = Cartridge::fromImage(RomImage::mapFile(path));
+    } catch (const std::exception&) {
+        return false;
+    }
+    nes.silent = true;
+    nes.powerOn();
+    PadState pad;
+    nes.input->source = &pad;
+
+    bool haveScreen = false;
+    for (int f = 0; f < kFrames; ++f) {
+        uint8_t buttons = 0;
+        for (int at : kStartPresses)
+            if (f >= at && f < at + kPressFrames) buttons |= kStart;
+        pad.publish(buttons, 0);
+
+        const bool sample = (f >= kFirstSample && (f - kFirstSample) % kSampleEvery == 0) || f == kFrames - 1;
+        nes.runFrame(/*compose=*/sample);
+        if (!sample) continue;
+        const bool blank = singleColor(*nes.ppu);
+        if (!blank || !haveScreen) {
+            downscale(*nes.ppu, pixels);
+            haveScreen = !blank;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+// rom_thumbnails.h
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "rom_library.h"
+
+// Previews for the ROM browser. A ROM without one is booted headless on a
+// worker (no audio device, no save file) and run for a few seconds with
+// Start pressed along the way; the last non-blank screen seen is box-filtered
+// down to kWidth x kHeight. Results are cached on disk as
+// <dir>/<sha1>.thumb, so each dump is emulated once whatever its file name.
+//
+// Requests are served newest first, so the rows on screen win over those
+// scrolled past, and the oldest are dropped when too many wait. While a
+// game is running only the spare hardware threads (ThreadPool::defaultHelpers,
+// less those a video filter's pool is using) generate, and none do on
+// machines without spare threads. Workers run at low OS priority.
+class RomThumbnails {
+   public:
+    static constexpr int kWidth = 64, kHeight = 60;  // ARGB8888
+
+    enum class Status { Pending, Ready, Failed };
+
+    explicit RomThumbnails(std::string dir);
+    ~RomThumbnails();  // drops what is queued, joins
+
+    // UI thread. Ready: `pixels` takes the thumbnail, which is then no longer
+    // held here (a later fetch reloads it from disk). Pending: queued.
+    Status fetch(const RomEntry& rom, std::vector<uint32_t>& pixels);
+
+    // While a game runs, stay off the threads it needs: `busyHelpers` of the
+    // spare ones are taken by the video filter pool
+    void setGameRunning(bool running, int busyHelpers = 0);
+
+   private:
+    static constexpr size_t kMaxQueued = 64;
+
+    struct Job {
+        std::string key;  // SHA-1, hex
+        std::string path;
+    };
+
+    void loop(int worker);
+    bool load(const std::string& key, std::vector<uint32_t>& pixels) const;
+    void save(const std::string& key, const std::vector<uint32_t>& pixels) const;
+    static bool generate(const std::string& path, std::vector<uint32_t>& pixels);
+
+    const std::string dir;
+    std::vector<std::thread> workers;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<Job> queue;                  // newest at the front
+    std::unordered_set<std::string> known;  // queued or in progress
+    std::unordered_map<std::string, std::vector<uint32_t>> ready;
+    std::unordered_set<std::string> failed;
+    int allowed = 0;  // workers [0, allowed) may take jobs
+    bool quit = false;
+};
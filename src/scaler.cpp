@@ -0,0 +1,303 @@
+// scaler.cpp
+#include "scaler.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "cpu_features.h"
+#include "ppu.h"
+#include "thread_pool.h"
+
+#ifdef NES_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr int kWidth = PPU::WIDTH;
+constexpr int kBandRows = 16;
+
+inline uint32_t* outRow(uint8_t* out, int pitch, int r) { return reinterpret_cast<uint32_t*>(out + (size_t)r * pitch); }
+
+// Neighborhood of source pixel E:  A B C
+//                                  D E F
+//                                  G H I
+
+// ===== Scalar (reference) =====
+void scale2xScalar(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint8_t* out, int pitch) {
+    uint32_t* o0 = outRow(out, pitch, 0);
+    uint32_t* o1 = outRow(out, pitch, 1);
+    for (int x = 0; x < kWidth; ++x) {
+        const uint32_t B = above[x], D = row[x - 1], E = row[x], F = row[x + 1], H = below[x];
+        uint32_t e0 = E, e1 = E, e2 = E, e3 = E;
+        if (B != H && D != F) {
+            if (D == B) e0 = D;
+            if (B == F) e1 = F;
+            if (D == H) e2 = D;
+            if (H == F) e3 = F;
+        }
+        o0[2 * x] = e0;
+        o0[2 * x + 1] = e1;
+        o1[2 * x] = e2;
+        o1[2 * x + 1] = e3;
+    }
+}
+
+void scale3xScalar(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint8_t* out, int pitch) {
+    uint32_t* o[3] = {outRow(out, pitch, 0), outRow(out, pitch, 1), outRow(out, pitch, 2)};
+    for (int x = 0; x < kWidth; ++x) {
+        const uint32_t A = above[x - 1], B = above[x], C = above[x + 1];
+        const uint32_t D = row[x - 1], E = row[x], F = row[x + 1];
+        const uint32_t G = below[x - 1], H = below[x], I = below[x + 1];
+        uint32_t e[9] = {E, E, E, E, E, E, E, E, E};
+        if (B != H && D != F) {
+            if (D == B) e[0] = D;
+            if ((D == B && E != C) || (B == F && E != A)) e[1] = B;
+            if (B == F) e[2] = F;
+            if ((D == B && E != G) || (D == H && E != A)) e[3] = D;
+            if ((B == F && E != I) || (H == F && E != C)) e[5] = F;
+            if (D == H) e[6] = D;
+            if ((D == H && E != I) || (H == F && E != G)) e[7] = H;
+            if (H == F) e[8] = F;
+        }
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 3; ++c) o[r][3 * x + c] = e[3 * r + c];
+    }
+}
+
+// Sum of absolute byte differences
+inline int dist(uint32_t a, uint32_t b) {
+    int d = 0;
+    for (int i = 0; i < 32; i += 8) d += std::abs((int)(a >> i & 0xFF) - (int)(b >> i & 0xFF));
+    return d;
+}
+
+// Per byte, rounding up (PAVGB)
+inline uint32_t average(uint32_t a, uint32_t b) {
+    uint32_t r = 0;
+    for (int i = 0; i < 32; i += 8) r |= (((a >> i & 0xFF) + (b >> i & 0xFF) + 1) >> 1) << i;
+    return r;
+}
+
+// One output corner: `P`/`Q` are the edge neighbors beside it (F/H for the
+// bottom right), `X` the pixel diagonally across it, `P2`/`Q2` the far side
+// neighbors (B/D), `U`/`V` the other two diagonals (C/G)
+inline uint32_t xbrCorner(uint32_t E, uint32_t P, uint32_t Q, uint32_t X, uint32_t P2, uint32_t Q2, uint32_t U,
+                          uint32_t V) {
+    if (E == P || E == Q) return E;
+    const int along = dist(E, U) + dist(E, V) + 4 * dist(P, Q);    // cost of an edge through P-Q
+    const int across = dist(P, P2) + dist(Q, Q2) + 4 * dist(E, X);  // cost of the E-X diagonal
+    if (along >= across) return E;
+    return average(E, dist(E, P) <= dist(E, Q) ? P : Q);
+}
+
+void xbrLiteScalar(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint8_t* out, int pitch) {
+    uint32_t* o0 = outRow(out, pitch, 0);
+    uint32_t* o1 = outRow(out, pitch, 1);
+    for (int x = 0; x < kWidth; ++x) {
+        const uint32_t A = above[x - 1], B = above[x], C = above[x + 1];
+        const uint32_t D = row[x - 1], E = row[x], F = row[x + 1];
+        const uint32_t G = below[x - 1], H = below[x], I = below[x + 1];
+        o0[2 * x] = xbrCorner(E, D, B, A, H, F, G, C);
+        o0[2 * x + 1] = xbrCorner(E, F, B, C, H, D, I, A);
+        o1[2 * x] = xbrCorner(E, D, H, G, B, F, A, I);
+        o1[2 * x + 1] = xbrCorner(E, F, H, I, B, D, C, G);
+    }
+}
+
+#ifdef NES_X86
+// ===== SSE2: 4 source pixels per step =====
+NES_TARGET_SSE2 inline __m128i sel(__m128i m, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+NES_TARGET_SSE2 inline __m128i ne(__m128i a, __m128i b) {
+    return _mm_xor_si128(_mm_cmpeq_epi32(a, b), _mm_set1_epi32(-1));
+}
+NES_TARGET_SSE2 inline __m128i load(const uint32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+NES_TARGET_SSE2 inline void store(uint32_t* p, __m128i v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+
+// 4 pixels each of a, b -> a0 b0 a1 b1 ... a3 b3
+NES_TARGET_SSE2 inline void store2(uint32_t* p, __m128i a, __m128i b) {
+    store(p, _mm_unpacklo_epi32(a, b));
+    store(p + 4, _mm_unpackhi_epi32(a, b));
+}
+
+// 4 pixels each of a, b, c -> a0 b0 c0 a1 ... c3
+NES_TARGET_SSE2 inline void store3(uint32_t* p, __m128i a, __m128i b, __m128i c) {
+    const __m128i ab0 = _mm_unpacklo_epi32(a, b), ab1 = _mm_unpackhi_epi32(a, b);  // a0 b0 a1 b1 | a2 b2 a3 b3
+    const __m128i bc0 = _mm_unpacklo_epi32(b, c), bc1 = _mm_unpackhi_epi32(b, c);  // b0 c0 b1 c1 | b2 c2 b3 c3
+    const __m128i an = _mm_srli_si128(a, 4);
+    const __m128i ca0 = _mm_unpacklo_epi32(c, an), ca1 = _mm_unpackhi_epi32(c, an);  // c0 a1 c1 a2 | c2 a3 c3 -
+    auto pick = [](__m128i x, __m128i y, int imm) {
+        return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(x), _mm_castsi128_ps(y), imm));
+    };
+    store(p, pick(ab0, ca0, _MM_SHUFFLE(1, 0, 1, 0)));      // a0 b0 c0 a1
+    store(p + 4, pick(bc0, ab1, _MM_SHUFFLE(1, 0, 3, 2)));  // b1 c1 a2 b2
+    store(p + 8, pick(ca1, bc1, _MM_SHUFFLE(3, 2, 1, 0)));  // c2 a3 b3 c3
+}
+
+NES_TARGET_SSE2 void scale2xSSE2(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint8_t* out,
+                                 int pitch) {
+    uint32_t* o0 = outRow(out, pitch, 0);
+    uint32_t* o1 = outRow(out, pitch, 1);
+    for (int x = 0; x < kWidth; x += 4) {
+        const __m128i B = load(above + x), D = load(row + x - 1), E = load(row + x), F = load(row + x + 1),
+                      H = load(below + x);
+        const __m128i c = _mm_and_si128(ne(B, H), ne(D, F));
+        store2(o0 + 2 * x, sel(_mm_and_si128(c, _mm_cmpeq_epi32(D, B)), D, E),
+               sel(_mm_and_si128(c, _mm_cmpeq_epi32(B, F)), F, E));
+        store2(o1 + 2 * x, sel(_mm_and_si128(c, _mm_cmpeq_epi32(D, H)), D, E),
+               sel(_mm_and_si128(c, _mm_cmpeq_epi32(H, F)), F, E));
+    }
+}
+
+NES_TARGET_SSE2 void scale3xSSE2(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint8_t* out,
+                                 int pitch) {
+    uint32_t* o0 = outRow(out, pitch, 0);
+    uint32_t* o1 = outRow(out, pitch, 1);
+    uint32_t* o2 = outRow(out, pitch, 2);
+    for (int x = 0; x < kWidth; x += 4) {
+        const __m128i A = load(above + x - 1), B = load(above + x), C = load(above + x + 1);
+        const __m128i D = load(row + x - 1), E = load(row + x), F = load(row + x + 1);
+        const __m128i G = load(below + x - 1), H = load(below + x), I = load(below + x + 1);
+        const __m128i c = _mm_and_si128(ne(B, H), ne(D, F));
+        const __m128i db = _mm_and_si128(c, _mm_cmpeq_epi32(D, B)), bf = _mm_and_si128(c, _mm_cmpeq_epi32(B, F));
+        const __m128i dh = _mm_and_si128(c, _mm_cmpeq_epi32(D, H)), hf = _mm_and_si128(c, _mm_cmpeq_epi32(H, F));
+        const __m128i nA = ne(E, A), nC = ne(E, C), nG = ne(E, G), nI = ne(E, I);
+        const __m128i e1 = _mm_or_si128(_mm_and_si128(db, nC), _mm_and_si128(bf, nA));
+        const __m128i e3 = _mm_or_si128(_mm_and_si128(db, nG), _mm_and_si128(dh, nA));
+        const __m128i e5 = _mm_or_si128(_mm_and_si128(bf, nI), _mm_and_si128(hf, nC));
+        const __m128i e7 = _mm_or_si128(_mm_and_si128(dh, nI), _mm_and_si128(hf, nG));
+        store3(o0 + 3 * x, sel(db, D, E), sel(e1, B, E), sel(bf, F, E));
+        store3(o1 + 3 * x, sel(e3, D, E), E, sel(e5, F, E));
+        store3(o2 + 3 * x, sel(dh, D, E), sel(e7, H, E), sel(hf, F, E));
+    }
+}
+
+// Per 32-bit lane: sum of absolute byte differences (at most 4 * 255)
+NES_TARGET_SSE2 inline __m128i dist4(__m128i a, __m128i b) {
+    const __m128i lo = _mm_set1_epi32(0x00FF00FF), lo16 = _mm_set1_epi32(0xFFFF);
+    const __m128i t = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+    const __m128i s = _mm_add_epi32(_mm_and_si128(t, lo), _mm_and_si128(_mm_srli_epi32(t, 8), lo));
+    return _mm_add_epi32(_mm_and_si128(s, lo16), _mm_srli_epi32(s, 16));
+}
+
+// As xbrCorner, with the distances the corners share passed in
+NES_TARGET_SSE2 inline __m128i xbrCorner4(__m128i E, __m128i P, __m128i Q, __m128i dEP, __m128i dEQ, __m128i dEX,
+                                          __m128i dEU, __m128i dEV, __m128i dPQ, __m128i dPP2, __m128i dQQ2) {
+    const __m128i along = _mm_add_epi32(_mm_add_epi32(dEU, dEV), _mm_slli_epi32(dPQ, 2));
+    const __m128i across = _mm_add_epi32(_mm_add_epi32(dPP2, dQQ2), _mm_slli_epi32(dEX, 2));
+    const __m128i edge = _mm_and_si128(_mm_cmplt_epi32(along, across),
+                                       _mm_and_si128(ne(E, P), ne(E, Q)));
+    const __m128i blend = _mm_avg_epu8(E, sel(_mm_cmpgt_epi32(dEP, dEQ), Q, P));
+    return sel(edge, blend, E);
+}
+
+NES_TARGET_SSE2 void xbrLiteSSE2(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint8_t* out,
+                                 int pitch) {
+    uint32_t* o0 = outRow(out, pitch, 0);
+    uint32_t* o1 = outRow(out, pitch, 1);
+    for (int x = 0; x < kWidth; x += 4) {
+        const __m128i A = load(above + x - 1), B = load(above + x), C = load(above + x + 1);
+        const __m128i D = load(row + x - 1), E = load(row + x), F = load(row + x + 1);
+        const __m128i G = load(below + x - 1), H = load(below + x), I = load(below + x + 1);
+        const __m128i dEA = dist4(E, A), dEB = dist4(E, B), dEC = dist4(E, C), dED = dist4(E, D);
+        const __m128i dEF = dist4(E, F), dEG = dist4(E, G), dEH = dist4(E, H), dEI = dist4(E, I);
+        const __m128i dBD = dist4(B, D), dBF = dist4(B, F), dDH = dist4(D, H), dFH = dist4(F, H);
+        store2(o0 + 2 * x, xbrCorner4(E, D, B, dED, dEB, dEA, dEG, dEC, dBD, dDH, dBF),
+               xbrCorner4(E, F, B, dEF, dEB, dEC, dEI, dEA, dBF, dFH, dBD));
+        store2(o1 + 2 * x, xbrCorner4(E, D, H, dED, dEH, dEG, dEA, dEI, dDH, dBD, dFH),
+               xbrCorner4(E, F, H, dEF, dEH, dEI, dEC, dEG, dFH, dBF, dDH));
+    }
+}
+#endif
+
+}  // namespace
+
+Scaler::Isa Scaler::bestIsa() {
+    return cpuFeatures().sse2 ? Isa::SSE2 : Isa::Scalar;
+}
+
+const char* Scaler::isaName(Isa isa) {
+    return isa == Isa::SSE2 ? "SSE2" : "scalar";
+}
+
+const char* Scaler::name(Kind kind) {
+    switch (kind) {
+        case Kind::Scale3x:
+            return "Scale3x";
+        case Kind::XbrLite:
+            return "xBR-lite";
+        default:
+            return "Scale2x";
+    }
+}
+
+int Scaler::factor(Kind kind) {
+    return kind == Kind::Scale3x ? 3 : 2;
+}
+
+Scaler::Scaler(Kind kind) : type(kind) {
+    forceIsa(bestIsa());
+}
+
+void Scaler::forceIsa(Isa isa) {
+    if (isa == Isa::SSE2 && !cpuFeatures().sse2) isa = Isa::Scalar;
+    active = isa;
+    switch (type) {
+        case Kind::Scale2x:
+            rowFn = &scale2xScalar;
+            break;
+        case Kind::Scale3x:
+            rowFn = &scale3xScalar;
+            break;
+        case Kind::XbrLite:
+            rowFn = &xbrLiteScalar;
+            break;
+    }
+#ifdef NES_X86
+    if (isa == Isa::SSE2) {
+        switch (type) {
+            case Kind::Scale2x:
+                rowFn = &scale2xSSE2;
+                break;
+            case Kind::Scale3x:
+                rowFn = &scale3xSSE2;
+                break;
+            case Kind::XbrLite:
+                rowFn = &xbrLiteSSE2;
+                break;
+        }
+    }
+#endif
+}
+
+void Scaler::scale(const uint32_t* in, void* out, int pitch, ThreadPool* pool) const {
+    constexpr int kBands = (PPU::HEIGHT + kBandRows - 1) / kBandRows;
+    const int n = factor();
+    auto band = [&](int b) {
+        // Rolling padded copies of the rows above, at and below y; edges repeat
+        uint32_t pad[3][kWidth + 2];
+        auto fill = [&](uint32_t* dst, int y) {
+            const uint32_t* src = in + std::min(std::max(y, 0), PPU::HEIGHT - 1) * kWidth;
+            std::memcpy(dst + 1, src, kWidth * sizeof(uint32_t));
+            dst[0] = src[0];
+            dst[kWidth + 1] = src[kWidth - 1];
+        };
+        const int y0 = b * kBandRows, y1 = std::min(PPU::HEIGHT, y0 + kBandRows);
+        fill(pad[0], y0 - 1);
+        fill(pad[1], y0);
+        for (int y = y0; y < y1; ++y) {
+            uint32_t* above = pad[(y - y0) % 3];
+            uint32_t* row = pad[(y - y0 + 1) % 3];
+            uint32_t* below = pad[(y - y0 + 2) % 3];
+            fill(below, y + 1);
+            rowFn(above + 1, row + 1, below + 1, static_cast<uint8_t*>(out) + (size_t)y * n * pitch, pitch);
+        }
+    };
+    if (pool) {
+        pool->run(kBands, band);
+    } else {
+        for (int b = 0; b < kBands; ++b) band(b);
+    }
+}
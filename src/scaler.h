@@ -0,0 +1,41 @@
+// scaler.h
+#pragma once
+#include <cstdint>
+
+struct ThreadPool;
+
+// Integer-factor pixel-art scalers for the expanded 256x240 frame, run on the
+// CPU: Scale2x and Scale3x (AdvMAME rules: copy a neighbor into a corner when
+// two edges meet there), and xBR-lite, a 3x3-neighborhood cut of xBR level 1
+// at 2x (corners blend halfway towards the closer neighbor when the color
+// distances favor an edge along that diagonal). SSE2 does 4 source pixels per
+// step, with a scalar fallback; all paths produce identical output. Frames
+// are split into bands of rows across a ThreadPool.
+struct Scaler {
+    enum class Kind { Scale2x, Scale3x, XbrLite };
+    enum class Isa { Scalar, SSE2 };
+
+    static Isa bestIsa();
+    static const char* isaName(Isa isa);
+    static const char* name(Kind kind);
+    static int factor(Kind kind);
+
+    explicit Scaler(Kind kind);
+    void forceIsa(Isa isa);  // benchmarking; clamped to what the CPU has
+    Isa isa() const { return active; }
+    Kind kind() const { return type; }
+    int factor() const { return factor(type); }
+
+    // `in`: 256x240 packed pixels; output rows (factor() * 256 pixels) are `pitch` bytes apart
+    void scale(const uint32_t* in, void* out, int pitch, ThreadPool* pool = nullptr) const;
+
+   private:
+    // Rows are padded: row[-1] and row[256] repeat the edge pixels. `out`
+    // points at the first of factor() output rows, `pitch` bytes apart.
+    using RowFn = void (*)(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint8_t* out,
+                           int pitch);
+
+    Kind type;
+    Isa active = Isa::Scalar;
+    RowFn rowFn = nullptr;
+};
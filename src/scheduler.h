@@ -0,0 +1,61 @@
+// scheduler.h
+#pragma once
+#include <cstdint>
+
+// Master event scheduler, timed in CPU cycles since power-on.
+// Components that do not need to run every cycle register a deadline here and
+// catch up lazily when it fires (or when the CPU touches them).
+// NES::runFrame advances `now` after each CPU step and dispatches due events.
+struct Scheduler {
+    enum Event : uint8_t {
+        ApuFrameSequencer,  // next quarter/half-frame step
+        ApuDmc,             // next DMC sample-byte boundary (fetch / IRQ)
+        EventCount
+    };
+    static constexpr uint64_t kNever = ~0ull;
+
+    uint64_t now = 0;
+
+    Scheduler() { reset(); }
+    void reset() {
+        now = 0;
+        for (uint64_t& d : deadline) d = kNever;
+        next = kNever;
+    }
+
+    void schedule(Event e, uint64_t at) {
+        deadline[e] = at;
+        refresh();
+    }
+    void cancel(Event e) {
+        if (deadline[e] == kNever) return;
+        deadline[e] = kNever;
+        refresh();
+    }
+    uint64_t when(Event e) const { return deadline[e]; }
+    uint64_t untilNext() const { return next > now ? next - now : 0; }  // cycles; huge if idle
+
+    // Pops the earliest event due at or before `now`. The event is unscheduled
+    // before it is returned; handlers re-arm it themselves.
+    bool popDue(Event& e, uint64_t& at) {
+        if (next > now) return false;
+        int best = 0;
+        for (int i = 1; i < EventCount; ++i)
+            if (deadline[i] < deadline[best]) best = i;
+        e = (Event)best;
+        at = deadline[best];
+        deadline[best] = kNever;
+        refresh();
+        return true;
+    }
+
+   private:
+    void refresh() {
+        next = kNever;
+        for (uint64_t d : deadline)
+            if (d < next) next = d;
+    }
+
+    uint64_t deadline[EventCount];
+    uint64_t next = kNever;
+};
@@ -0,0 +1,61 @@
+// thread_pool.cpp
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int count) {
+    for (int i = 0; i < count; ++i) helpers.emplace_back([this] { loop(); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        quit = true;
+    }
+    cvWork.notify_all();
+    for (std::thread& t : helpers) t.join();
+}
+
+int ThreadPool::defaultHelpers() {
+    int hw = (int)std::thread::hardware_concurrency();
+    return std::max(0, std::min(hw - 3, 7));
+}
+
+void ThreadPool::drain() {
+    for (int j; (j = nextJob.fetch_add(1, std::memory_order_relaxed)) < jobCount;) (*work)(j);
+}
+
+void ThreadPool::run(int jobs, const std::function<void(int job)>& fn) {
+    if (helpers.empty() || jobs <= 1) {
+        for (int j = 0; j < jobs; ++j) fn(j);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        work = &fn;
+        jobCount = jobs;
+        nextJob.store(0, std::memory_order_relaxed);
+        busy = (int)helpers.size();
+        ++generation;
+    }
+    cvWork.notify_all();
+    drain();
+    std::unique_lock<std::mutex> lk(mtx);
+    cvDone.wait(lk, [&] { return busy == 0; });
+    work = nullptr;
+}
+
+void ThreadPool::loop() {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            cvWork.wait(lk, [&] { return quit || generation != seen; });
+            if (quit) return;
+            seen = generation;
+        }
+        drain();
+        std::lock_guard<std::mutex> lk(mtx);
+        if (--busy == 0) cvDone.notify_one();
+    }
+}
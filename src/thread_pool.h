@@ -0,0 +1,39 @@
+// thread_pool.h
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of helper threads for splitting one piece of work into bands
+// (video filters). run() hands job indices to the helpers and the calling
+// thread alike and returns when all of them are done; without helpers it is
+// a plain loop on the caller.
+struct ThreadPool {
+    explicit ThreadPool(int helpers = defaultHelpers());
+    ~ThreadPool();
+
+    // Hardware threads left over after the emulation, audio and video threads
+    static int defaultHelpers();
+    int threads() const { return (int)helpers.size() + 1; }
+
+    // Calls fn(0..jobs-1), each once, in any order; one caller at a time
+    void run(int jobs, const std::function<void(int job)>& fn);
+
+   private:
+    void loop();
+    void drain();
+
+    std::vector<std::thread> helpers;
+    std::mutex mtx;
+    std::condition_variable cvWork, cvDone;
+    const std::function<void(int)>* work = nullptr;
+    int jobCount = 0;
+    std::atomic<int> nextJob{0};
+    int busy = 0;             // helpers still in the current round
+    uint64_t generation = 0;  // bumped per run()
+    bool quit = false;
+};
@@ -468,6 +468,13 @@ void RenderSDL() {
                     SDL_RenderFillRect(ctx.renderer, &r);
                     break;
                 }
+                case CmdType::Image: {
+                    if (!cmd.texture) break;
+                    set_clip();
+                    SDL_Rect dst{int(cmd.rect.x), int(cmd.rect.y), int(cmd.rect.w), int(cmd.rect.h)};
+                    SDL_RenderCopy(ctx.renderer, cmd.texture, nullptr, &dst);
+                    break;
+                }
                 case CmdType::Text: {
                     if (cmd.text.empty()) break;
                     set_clip();
@@ -1428,7 +1435,8 @@ bool Selectable(const char *label, bool *selected, bool full_width) {
     return clicked;
 }
 
-bool ListBox(const char *label, int *current_index, const std::vector<std::string> &items, int height_in_items) {
+bool ListBox(const char *label, int *current_index, const std::vector<std::string> &items, int height_in_items,
+             const std::function<SDL_Texture *(int index)> &icon, float icon_w, float icon_h) {
     auto &ctx = GetContext();
     if (!ctx.insideWindow) return false;
     auto &L = ctx.layouts[ctx.currentWindowTitle];
@@ -1437,7 +1445,8 @@ bool ListBox(const char *label, int *current_index, const std::vector<std::strin
     const float spacing = ctx.style.itemSpacing;
     const float startX = ctx.currentWindowRect.x + pad;
     const float totalW = ctx.currentWindowRect.w - pad * 2.0f;
-    const float itemH = ctx.style.menuItemHeight;
+    const float itemH = icon ? std::max(ctx.style.menuItemHeight, icon_h + 4.0f) : ctx.style.menuItemHeight;
+    const float textX = icon ? pad + icon_w + pad : pad;
 
     // label
     int lw=0, lh=0; TTF_SizeUTF8(ctx.font, label, &lw, &lh);
@@ -1490,9 +1499,15 @@ bool ListBox(const char *label, int *current_index, const std::vector<std::strin
                                            : (rowHover ? ctx.style.menuItemHoverBg : Color{0,0,0,0});
         if (bg.a > 0.0f) ctx.commands.push_back({CmdType::Rect, row, "", bg});
 
+        if (icon) {
+            if (SDL_Texture *tex = icon(idx))
+                ctx.commands.push_back({CmdType::Image,
+                    {row.x + pad, row.y + (row.h - icon_h) * 0.5f, icon_w, icon_h}, "", {}, tex});
+        }
+
         int tw=0, th=0; TTF_SizeUTF8(ctx.font, items[idx].c_str(), &tw, &th);
         ctx.commands.push_back({CmdType::Text,
-            {row.x + pad, row.y + (row.h - th) * 0.5f, float(tw), float(th)},
+            {row.x + textX, row.y + (row.h - th) * 0.5f, float(tw), float(th)},
             items[idx], ctx.style.text});
 
         if (rowHover && ctx.io.mouseReleased) {
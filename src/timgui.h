@@ -22,6 +22,7 @@ struct Rect {
 enum class CmdType {
     Rect,
     Text,
+    Image,
     PushClip,
     PopClip
 };
@@ -31,6 +32,7 @@ struct DrawCmd {
     Rect rect;
     std::string text;  // for Text
     Color color;
+    SDL_Texture *texture = nullptr;  // for Image; owned by the caller, drawn at rect size
 };
 using DrawList = std::vector<DrawCmd>;
 
@@ -314,7 +316,10 @@ void ProgressBar(float fraction, float width = -1.0f);
 
 bool RadioButton(const char *label, int *v, int v_value);
 bool Selectable(const char *label, bool *selected = nullptr, bool full_width = true);
-bool ListBox(const char *label, int *current_index, const std::vector<std::string> &items, int height_in_items = 6);
+// With `icon`, rows grow to fit an icon_w x icon_h image left of the text;
+// it is called for the rows on screen only, and may return nullptr
+bool ListBox(const char *label, int *current_index, const std::vector<std::string> &items, int height_in_items = 6,
+             const std::function<SDL_Texture *(int index)> &icon = nullptr, float icon_w = 0.0f, float icon_h = 0.0f);
 bool Combo(const char *label, int *current_index, const std::vector<std::string> &items, int max_visible_items = 6);
 bool DragFloat(const char *label, float *v, float speed, float v_min, float v_max, const char *format = "%.3f");
 
@@ -0,0 +1,38 @@
+// triple_buffer.h
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer / single-consumer triple buffer.
+// The producer always has a private slot to write into, the consumer always
+// has a stable slot to read from; the third slot is exchanged atomically.
+// The consumer only ever sees the most recently published item.
+template <typename T>
+struct TripleBuffer {
+    // ---- producer side ----
+    T& writeBuffer() { return slots[back]; }
+    void publish() {
+        // Hand our slot over as the new "middle", take the old middle as our next back slot
+        uint8_t prev = middle.exchange((uint8_t)(back | kFresh), std::memory_order_acq_rel);
+        back = prev & kIndexMask;
+    }
+
+    // ---- consumer side ----
+    // Returns true if a newer item was published since the last call.
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & kFresh)) return false;
+        uint8_t prev = middle.exchange(front, std::memory_order_acq_rel);
+        front = prev & kIndexMask;
+        return true;
+    }
+    const T& readBuffer() const { return slots[front]; }
+
+   private:
+    static constexpr uint8_t kIndexMask = 0x03;
+    static constexpr uint8_t kFresh = 0x04;
+
+    T slots[3]{};
+    std::atomic<uint8_t> middle{1};
+    uint8_t back = 0;   // producer-owned
+    uint8_t front = 2;  // consumer-owned
+};
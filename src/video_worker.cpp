@@ -0,0 +1,152 @@
+// video_worker.cpp
+#include "video_worker.h"
+
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+// 64-bit multiply-xorshift over 8-byte words: ~20 us per frame, and only
+// has to tell consecutive frames apart
+static uint64_t frameHash(const EmuFrame& f) {
+    auto mix = [](uint64_t h, const uint8_t* p, size_t n) {
+        for (size_t i = 0; i < n; i += 8) {
+            uint64_t w;
+            std::memcpy(&w, p + i, 8);
+            h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+            h ^= h >> 29;
+        }
+        return h;
+    };
+    static_assert(sizeof(f.indices) % 8 == 0 && sizeof(f.emphasis) % 8 == 0, "hashed in 8-byte words");
+    return mix(mix(0, f.indices, sizeof(f.indices)), f.emphasis, sizeof(f.emphasis));
+}
+
+void VideoWorker::start(Palette::Layout layout) {
+    if (thr.joinable()) return;
+    palette = std::make_unique<Palette>(PPU::kNesPalette.data(), layout);
+    // One buffer per queue slot, one being filled, one being processed
+    while (spare.size() < kMaxQueued + 2) spare.push_back(std::make_unique<EmuFrame>());
+    haveLast = false;
+    quit = false;
+    thr = std::thread([this] { run(); });
+}
+
+void VideoWorker::stop() {
+    if (!thr.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        quit = true;
+    }
+    cvWork.notify_one();
+    thr.join();
+    for (auto& f : queue) spare.push_back(std::move(f));
+    queue.clear();
+}
+
+void VideoWorker::submit(const uint8_t* indices, const uint8_t* emphasis, uint64_t frameNo) {
+    std::unique_ptr<EmuFrame> f;
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (!spare.empty()) {
+            f = std::move(spare.back());
+            spare.pop_back();
+        } else if (!queue.empty()) {
+            // Worker is behind: the oldest waiting frame will never be shown
+            f = std::move(queue.front());
+            queue.pop_front();
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!f) f = std::make_unique<EmuFrame>();  // not started
+    std::memcpy(f->indices, indices, sizeof(f->indices));
+    std::memcpy(f->emphasis, emphasis, sizeof(f->emphasis));
+    f->frameNo = frameNo;
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        queue.push_back(std::move(f));
+        while (queue.size() > kMaxQueued) {
+            spare.push_back(std::move(queue.front()));
+            queue.pop_front();
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    cvWork.notify_one();
+}
+
+void VideoWorker::setFilter(Filter f, bool needsRgb) {
+    std::lock_guard<std::mutex> lk(stageMtx);
+    filter = std::move(f);
+    filterNeedsRgb = needsRgb;
+    filterMs = 0.0;
+    haveLast = false;  // same input, different output: republish
+}
+
+void VideoWorker::setSink(Sink s) {
+    std::lock_guard<std::mutex> lk(stageMtx);
+    sink = std::move(s);
+}
+
+void VideoWorker::run() {
+    for (;;) {
+        std::unique_ptr<EmuFrame> f;
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            cvWork.wait(lk, [&] { return quit || !queue.empty(); });
+            if (quit) return;
+            f = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        process(*f);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        workMs = workMs.load(std::memory_order_relaxed) * 0.9 + ms * 0.1;
+
+        std::lock_guard<std::mutex> lk(mtx);
+        spare.push_back(std::move(f));
+    }
+}
+
+void VideoWorker::process(const EmuFrame& in) {
+    const uint64_t hash = frameHash(in);
+    std::lock_guard<std::mutex> lk(stageMtx);
+    const bool same = haveLast && hash == lastHash;
+    if (same) unchanged.fetch_add(1, std::memory_order_relaxed);
+    if (same && !sink) return;
+
+    VideoFrame& out = frames.writeBuffer();
+    out.frameNo = in.frameNo;
+    out.indexed = !filter && !sink;
+    if (out.indexed) {
+        // The UI thread expands it into the texture
+        out.width = PPU::WIDTH;
+        out.height = PPU::HEIGHT;
+        out.indices.assign(in.indices, in.indices + sizeof(in.indices));
+        std::memcpy(out.emphasis, in.emphasis, sizeof(out.emphasis));
+        frames.publish();
+        lastHash = hash;
+        haveLast = true;
+        return;
+    }
+
+    // Expand into the output slot directly unless a filter rewrites it
+    if (!filter || filterNeedsRgb) {
+        VideoFrame& rgb = filter ? expanded : out;
+        rgb.width = PPU::WIDTH;
+        rgb.height = PPU::HEIGHT;
+        rgb.pixels.resize((size_t)PPU::WIDTH * PPU::HEIGHT);
+        palette->expandFrame(in.indices, in.emphasis, rgb.pixels.data(), PPU::WIDTH * sizeof(uint32_t));
+    }
+    if (filter) {
+        auto t0 = std::chrono::steady_clock::now();
+        filter(in, expanded, out);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        filterMs = filterMs.load(std::memory_order_relaxed) * 0.9 + ms * 0.1;
+    }
+
+    if (sink) sink(out);
+    if (same) return;  // the UI already has this picture
+    frames.publish();
+    lastHash = hash;
+    haveLast = true;
+}
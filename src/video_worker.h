@@ -0,0 +1,98 @@
+// video_worker.h
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "palette.h"
+#include "ppu.h"
+#include "thread_pool.h"
+#include "triple_buffer.h"
+
+// A finished frame handed from the emulation thread to the video worker,
+// still in palette-index form (see PPU::frameIndex)
+struct EmuFrame {
+    uint8_t indices[PPU::WIDTH * PPU::HEIGHT];
+    uint8_t emphasis[PPU::HEIGHT];
+    uint64_t frameNo = 0;
+};
+
+// A post-processed frame, ready for the texture: `width` x `height` packed
+// rows of 32-bit pixels in the worker's Palette::Layout. Unfiltered frames
+// with no sink to feed stay `indexed` (PPU::WIDTH x PPU::HEIGHT, `pixels`
+// unused) for the UI thread to expand straight into the locked texture:
+// one pass over the texture and no staging copy of RGB pixels.
+struct VideoFrame {
+    std::vector<uint32_t> pixels;
+    int width = 0, height = 0;
+    uint64_t frameNo = 0;
+    bool indexed = false;
+    std::vector<uint8_t> indices;  // indexed: PPU::frameIndex layout
+    uint8_t emphasis[PPU::HEIGHT] = {};
+};
+
+// Post-processes frame N (hash, palette expansion or filter, sink) while the
+// emulation thread runs frame N+1. Submitted frames wait in a short queue of
+// pooled buffers; if the worker falls behind, the oldest waiting frame is
+// dropped, so the emulation thread never blocks on video. Frames identical to
+// the previous one are not republished. Nothing is allocated once the pools
+// and the triple buffer's pixel vectors have reached their working size.
+struct VideoWorker {
+    // Replaces the plain palette expansion (scalers, NTSC, ...): reads the
+    // indices in `src` and/or their expansion `rgb`, sizes and fills `out`
+    using Filter = std::function<void(const EmuFrame& src, const VideoFrame& rgb, VideoFrame& out)>;
+    // Sees every processed frame, unchanged ones included (recorders)
+    using Sink = std::function<void(const VideoFrame& frame)>;
+
+    // worker -> UI: the newest processed frame
+    TripleBuffer<VideoFrame> frames;
+    ThreadPool pool;  // for filters to split frames into bands
+    std::atomic<double> workMs{0.0};       // EMA of per-frame processing time
+    std::atomic<double> filterMs{0.0};     // EMA of the filter's share of it
+    std::atomic<uint64_t> dropped{0};      // replaced before the worker got to them
+    std::atomic<uint64_t> unchanged{0};    // identical to the previous frame
+
+    ~VideoWorker() { stop(); }
+    void start(Palette::Layout layout);
+    void stop();  // drops what is queued, joins; safe to call twice
+
+    // For expanding `indexed` frames; valid once started
+    const Palette& outputPalette() const { return *palette; }
+
+    // Emulation thread; copies the frame
+    void submit(const uint8_t* indices, const uint8_t* emphasis, uint64_t frameNo);
+
+    // Any thread; take effect from the next frame. `rgb` is left empty
+    // unless `needsRgb`.
+    void setFilter(Filter f, bool needsRgb = true);
+    void setSink(Sink s);
+
+   private:
+    static constexpr size_t kMaxQueued = 2;  // frames
+
+    void run();
+    void process(const EmuFrame& in);
+
+    std::unique_ptr<Palette> palette;  // built for the texture's layout
+    VideoFrame expanded;               // filter input
+    uint64_t lastHash = 0;
+    bool haveLast = false;
+
+    std::mutex stageMtx;  // filter, sink, haveLast
+    Filter filter;
+    bool filterNeedsRgb = true;
+    Sink sink;
+
+    std::thread thr;
+    std::mutex mtx;
+    std::condition_variable cvWork;
+    std::deque<std::unique_ptr<EmuFrame>> queue;
+    std::vector<std::unique_ptr<EmuFrame>> spare;  // recycled frame buffers
+    bool quit = false;
+};
@@ -0,0 +1,128 @@
+// wav_writer.cpp
+#include "wav_writer.h"
+
+#include <algorithm>
+#include <utility>
+
+static void putLE(uint8_t* p, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+bool WavWriter::writeHeader(FILE* fp, int sampleRate, uint64_t samples) {
+    // Canonical 44-byte PCM header; sizes are clamped to what RIFF can express
+    uint32_t dataBytes = (uint32_t)std::min<uint64_t>(samples * 2, 0xFFFFFFFFull - 36);
+    uint8_t h[44];
+    std::copy_n("RIFF", 4, h);
+    putLE(h + 4, 36 + dataBytes, 4);
+    std::copy_n("WAVEfmt ", 8, h + 8);
+    putLE(h + 16, 16, 4);              // fmt chunk size
+    putLE(h + 20, 1, 2);               // PCM
+    putLE(h + 22, 1, 2);               // mono
+    putLE(h + 24, (uint32_t)sampleRate, 4);
+    putLE(h + 28, (uint32_t)sampleRate * 2, 4);  // byte rate
+    putLE(h + 32, 2, 2);               // block align
+    putLE(h + 34, 16, 2);              // bits per sample
+    std::copy_n("data", 4, h + 36);
+    putLE(h + 40, dataBytes, 4);
+    return std::fseek(fp, 0, SEEK_SET) == 0 && std::fwrite(h, 1, sizeof(h), fp) == sizeof(h);
+}
+
+bool WavWriter::open(const std::vector<std::string>& paths, int sampleRate) {
+    close();
+    rate = sampleRate;
+    failed = false;
+    quit = false;
+    tracks.assign(paths.size(), Track{});
+    for (size_t i = 0; i < paths.size(); ++i) {
+        Track& t = tracks[i];
+        t.fp = std::fopen(paths[i].c_str(), "wb");
+        if (!t.fp || !writeHeader(t.fp, rate, 0)) {
+            close();
+            return false;
+        }
+        t.pending.reserve(kBlockSamples);
+    }
+    thr = std::thread([this] { run(); });
+    return true;
+}
+
+void WavWriter::write(int track, const int16_t* samples, size_t count) {
+    Track& t = tracks[track];
+    t.samples += count;
+    while (count > 0) {
+        size_t n = std::min(count, kBlockSamples - t.pending.size());
+        t.pending.insert(t.pending.end(), samples, samples + n);
+        samples += n;
+        count -= n;
+        if (t.pending.size() == kBlockSamples) submit(track);
+    }
+}
+
+void WavWriter::submit(int track) {
+    Block b;
+    b.track = track;
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        cvSpace.wait(lk, [&] { return queue.size() < kMaxQueued; });
+        if (!spare.empty()) {
+            b.data = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+    b.data.clear();
+    b.data.swap(tracks[track].pending);  // the track keeps writing into the recycled buffer
+    tracks[track].pending.reserve(kBlockSamples);
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        queue.push_back(std::move(b));
+    }
+    cvWork.notify_one();
+}
+
+void WavWriter::run() {
+    for (;;) {
+        Block b;
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            cvWork.wait(lk, [&] { return quit || !queue.empty(); });
+            if (queue.empty()) return;  // quit, and everything is on disk
+            b = std::move(queue.front());
+            queue.pop_front();
+        }
+        cvSpace.notify_one();
+
+        // WAV is little-endian, as is every host this builds for
+        FILE* fp = tracks[b.track].fp;
+        bool ok = std::fwrite(b.data.data(), sizeof(int16_t), b.data.size(), fp) == b.data.size();
+
+        std::lock_guard<std::mutex> lk(mtx);
+        if (!ok) failed = true;
+        spare.push_back(std::move(b.data));
+    }
+}
+
+bool WavWriter::close() {
+    if (thr.joinable()) {
+        for (size_t i = 0; i < tracks.size(); ++i)
+            if (!tracks[i].pending.empty()) submit((int)i);
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            quit = true;
+        }
+        cvWork.notify_one();
+        thr.join();
+    }
+
+    bool ok = !failed;
+    for (Track& t : tracks) {
+        if (!t.fp) {
+            ok = false;
+            continue;
+        }
+        ok = writeHeader(t.fp, rate, t.samples) && ok;
+        ok = (std::fclose(t.fp) == 0) && ok;
+    }
+    tracks.clear();
+    queue.clear();
+    return ok;
+}
@@ -0,0 +1,53 @@
+// wav_writer.h
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes one or more 16-bit mono WAV files from a background thread.
+// write() only appends to the track's pending block; full blocks are queued
+// for the writer thread, so the producer never waits on the disk unless it
+// gets kMaxQueued blocks ahead. Headers are finalized by close().
+struct WavWriter {
+    static constexpr size_t kBlockSamples = 1 << 16;  // per track, ~1.4 s at 48 kHz
+    static constexpr size_t kMaxQueued = 16;          // blocks
+
+    ~WavWriter() { close(); }
+
+    bool open(const std::vector<std::string>& paths, int sampleRate);  // one track per path
+    void write(int track, const int16_t* samples, size_t count);
+    bool close();  // flushes, patches the headers, joins; false if any I/O failed
+
+    uint64_t samplesWritten(int track) const { return tracks[track].samples; }
+
+   private:
+    struct Track {
+        FILE* fp = nullptr;
+        std::vector<int16_t> pending;
+        uint64_t samples = 0;
+    };
+    struct Block {
+        int track = 0;
+        std::vector<int16_t> data;
+    };
+
+    void run();
+    void submit(int track);
+    static bool writeHeader(FILE* fp, int sampleRate, uint64_t samples);
+
+    int rate = 0;
+    std::vector<Track> tracks;
+
+    std::thread thr;
+    std::mutex mtx;
+    std::condition_variable cvWork, cvSpace;
+    std::deque<Block> queue;
+    std::vector<std::vector<int16_t>> spare;  // recycled block buffers
+    bool quit = false;
+    bool failed = false;  // writer thread
+};